@@ -0,0 +1,184 @@
+#include "entity_system.h"
+
+#include "GLM/gtx/transform.hpp"
+
+/* Entity Constants */
+
+// Half the size of a rover's box, the radius of its body
+static const float rover_radius = 0.0763892f;
+
+static const float rover_body_scale = 0.08f;
+static const float rover_tire_scale = 0.015f;
+
+// Tires under the rover body, relative to its center
+static const glm::vec3 rover_tire_offsets[4] = {
+	glm::vec3(0.05f, -0.07f, 0.02f),
+	glm::vec3(-0.05f, -0.07f, 0.02f),
+	glm::vec3(0.05f, -0.07f, -0.04f),
+	glm::vec3(-0.05f, -0.07f, -0.04f)
+};
+
+// Tires wobble around a tilted axis while their rover drives
+static const glm::vec3 wobble_axis = glm::vec3(0.1f, 0, 0.1f);
+static const float rover_tire_wobble_amplitude = glm::radians(10.f);
+static const float wobble_frequency = 40;
+
+/* Entity Functions */
+bool CheckCollision(const glm::vec3& first, const glm::vec3& second)
+{
+	auto r = rover_radius;
+	// collision x-axis?
+	bool collisionX = first.x + r >= second.x - r &&
+		second.x + r >= first.x - r;
+	// collision y-axis?
+	bool collisionY = first.y + r >= second.y - r &&
+		second.y + r >= first.y - r;
+	// collision z-axis?
+	bool collisionZ = first.z + r >= second.z - r &&
+		second.z + r >= first.z - r;
+	// collision only if on all axes
+	return collisionX && collisionY && collisionZ;
+}
+
+int CreateEntity(EntityStore& store, const glm::vec3& position, int parent)
+{
+	store.positions.push_back(position);
+	store.velocities.push_back(glm::vec3(0));
+	store.orientations.push_back(glm::quat(1, 0, 0, 0));
+	store.scales.push_back(1);
+	store.parents.push_back(parent);
+	store.mesh_ids.push_back(-1);
+	store.colors.push_back(glm::vec3(1));
+	store.wobble_amplitudes.push_back(0);
+	store.driving.push_back(0);
+	store.chase_targets.push_back(-1);
+	store.chase_rates.push_back(0);
+	store.collided.push_back(0);
+	store.world_positions.push_back(parent < 0 ? position : store.world_positions[parent] + position);
+	return int(store.positions.size()) - 1;
+}
+
+int CreateRover(
+	EntityStore& store,
+	const glm::vec3& position,
+	const glm::vec3& color,
+	int body_mesh,
+	int tire_mesh,
+	int chase_target,
+	float chase_rate
+)
+{
+	auto body = CreateEntity(store, position);
+	store.scales[body] = rover_body_scale;
+	store.mesh_ids[body] = body_mesh;
+	store.colors[body] = color;
+	store.chase_targets[body] = chase_target;
+	store.chase_rates[body] = chase_rate;
+
+	// The torus lies in the xz plane, the tires stand up on their side
+	auto tire_orientation = glm::angleAxis(glm::radians(90.f), glm::vec3(0, 0, 1));
+	for (auto& offset : rover_tire_offsets)
+	{
+		auto tire = CreateEntity(store, offset, body);
+		store.orientations[tire] = tire_orientation;
+		store.scales[tire] = rover_tire_scale;
+		store.mesh_ids[tire] = tire_mesh;
+		store.colors[tire] = glm::vec3(0);
+		store.wobble_amplitudes[tire] = rover_tire_wobble_amplitude;
+	}
+	return body;
+}
+
+std::vector<int> CreateRovers(EntityStore& store, const std::vector<RoverDescription>& rovers, int body_mesh, int tire_mesh)
+{
+	// Chased rovers may come later in the list, their bodies are only known once all are created
+	std::vector<int> bodies;
+	for (auto& rover : rovers)
+		bodies.push_back(CreateRover(store, rover.position, rover.color, body_mesh, tire_mesh));
+	for (size_t i = 0; i < rovers.size(); ++i)
+		if (rovers[i].chase_rover >= 0)
+		{
+			store.chase_targets[bodies[i]] = bodies[rovers[i].chase_rover];
+			store.chase_rates[bodies[i]] = rovers[i].chase_rate;
+		}
+	return bodies;
+}
+
+void ChaseTargets(EntityStore& store, bool chasing)
+{
+	for (size_t i = 0; i < store.chase_targets.size(); ++i)
+	{
+		auto target = store.chase_targets[i];
+		if (target < 0)
+			continue;
+
+		// Chasers keep their tires turning while they chase, also once they have caught their target
+		store.driving[i] = chasing;
+		if (!chasing || store.collided[i])
+			continue;
+
+		auto world_position = glm::mix(store.world_positions[target], store.world_positions[i], 1 - store.chase_rates[i]);
+		store.positions[i] += world_position - store.world_positions[i];
+	}
+}
+
+void IntegrateVelocities(EntityStore& store, float delta_time)
+{
+	for (size_t i = 0; i < store.positions.size(); ++i)
+	{
+		if (store.collided[i])
+			store.velocities[i] = glm::vec3(0);
+		store.positions[i] += store.velocities[i] * delta_time;
+	}
+}
+
+int DetectCollisions(EntityStore& store)
+{
+	int caught = 0;
+	for (size_t i = 0; i < store.chase_targets.size(); ++i)
+	{
+		auto target = store.chase_targets[i];
+		if (target < 0 || store.collided[i] || !CheckCollision(store.world_positions[i], store.world_positions[target]))
+			continue;
+		++caught;
+		store.collided[i] = 1;
+		store.collided[target] = 1;
+	}
+	return caught;
+}
+
+void UpdateWorldPositions(EntityStore& store)
+{
+	for (size_t i = 0; i < store.positions.size(); ++i)
+	{
+		auto parent = store.parents[i];
+		store.world_positions[i] = parent < 0 ? store.positions[i] : store.world_positions[parent] + store.positions[i];
+	}
+}
+
+void FillInstanceBatches(const EntityStore& store, std::vector<InstanceBatch*>& batches)
+{
+	for (auto batch : batches)
+		batch->instances.clear();
+
+	// Every instance only differs from this one in its model, color and wobble amplitude
+	auto instance = CreateMeshInstance(glm::mat4(1), glm::vec3(0), false, wobble_axis, 0, wobble_frequency);
+	for (size_t i = 0; i < store.mesh_ids.size(); ++i)
+	{
+		auto mesh_id = store.mesh_ids[i];
+		if (mesh_id < 0)
+			continue;
+
+		auto root = int(i);
+		while (store.parents[root] >= 0)
+			root = store.parents[root];
+		auto driving = store.driving[root] != 0;
+
+		// Same as translate * rotate * scale
+		instance.model = glm::mat4(glm::mat3_cast(store.orientations[i]) * store.scales[i]);
+		instance.model[3] = glm::vec4(store.world_positions[i], 1);
+		instance.color = store.colors[i];
+		instance.wobble_amplitude = driving ? store.wobble_amplitudes[i] : 0.f;
+		batches[mesh_id]->instances.push_back(instance);
+	}
+}
\ No newline at end of file
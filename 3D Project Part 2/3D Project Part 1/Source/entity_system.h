@@ -0,0 +1,98 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLM/gtc/quaternion.hpp"
+
+#include "mesh_instancing.h"
+
+/* Entity Structs */
+
+// Entities as a structure of arrays, entity i is element i of every component array, so each
+// system only walks the arrays it uses. Entities are never removed.
+struct EntityStore
+{
+	// Relative to the parent when there is one, children follow the parent's position but not
+	// its orientation or scale. Velocities are in units per second, chasing entities move by
+	// ChaseTargets instead.
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> velocities;
+	std::vector<glm::quat> orientations;
+	std::vector<float> scales;
+
+	// Parents come before their children, -1 for none
+	std::vector<int> parents;
+
+	// Index of the instance batch the entity is drawn with, -1 for none
+	std::vector<int> mesh_ids;
+	std::vector<glm::vec3> colors;
+
+	// Wobble of the instance while the root entity drives, see MeshInstance
+	std::vector<float> wobble_amplitudes;
+
+	// Set for the entity the user drives while a drive key is held, and by ChaseTargets for the chasers
+	std::vector<unsigned char> driving;
+
+	// Entity followed by ChaseTargets, -1 for none, and part of the distance closed every frame
+	std::vector<int> chase_targets;
+	std::vector<float> chase_rates;
+
+	// Set by DetectCollisions, entities that collided stop moving
+	std::vector<unsigned char> collided;
+
+	// Found by UpdateWorldPositions
+	std::vector<glm::vec3> world_positions;
+};
+
+// A rover is a body with four tires as its children, see CreateRover
+struct RoverDescription
+{
+	glm::vec3 position;
+	glm::vec3 color;
+
+	// Index in the list of rovers of the rover to chase, -1 for none
+	int chase_rover;
+	float chase_rate;
+};
+
+/* Entity Functions */
+
+// AABB - AABB collision of two rovers
+bool CheckCollision(const glm::vec3& first, const glm::vec3& second);
+
+// Adds an entity without mesh, motion or parent at position, returns its index
+int CreateEntity(EntityStore& store, const glm::vec3& position, int parent = -1);
+
+// Adds the body of the rover drawn with body_mesh and its tires drawn with tire_mesh, returns the body.
+// chase_target is the body entity of the rover to chase, or -1.
+int CreateRover(
+	EntityStore& store,
+	const glm::vec3& position,
+	const glm::vec3& color,
+	int body_mesh,
+	int tire_mesh,
+	int chase_target = -1,
+	float chase_rate = 0
+);
+
+// Creates the rovers in order, returns their body entities
+std::vector<int> CreateRovers(EntityStore& store, const std::vector<RoverDescription>& rovers, int body_mesh, int tire_mesh);
+
+// Moves the chasing entities that have not collided their chase rate of the way to their targets, every
+// call regardless of the frame time. Nothing moves when chasing is false. Uses the world positions of the
+// last UpdateWorldPositions, the children of the chasers follow at the next one.
+void ChaseTargets(EntityStore& store, bool chasing = true);
+
+// Moves every entity that has not collided by its velocity
+void IntegrateVelocities(EntityStore& store, float delta_time);
+
+// Chasing entities that reach their target stop together with it, returns the number of
+// chasing entities that reached their target this call
+int DetectCollisions(EntityStore& store);
+
+void UpdateWorldPositions(EntityStore& store);
+
+// Clears the batches and fills batches[mesh_id] with the entities drawn with it, from the world
+// positions of the last UpdateWorldPositions
+void FillInstanceBatches(const EntityStore& store, std::vector<InstanceBatch*>& batches);
\ No newline at end of file
@@ -1,5 +1,8 @@
+#include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <vector>
+#include <string>
 
 #define GLM_FORCE_LEFT_HANDED
 #include "GLM/glm.hpp"
@@ -14,6 +17,20 @@
 
 #include "opengl_utilities.h"
 #include "mesh_generation.h"
+#include "mesh_optimization.h"
+#include "mesh_lod.h"
+#include "mesh_culling.h"
+#include "mesh_cache.h"
+#include "mesh_procedural.h"
+#include "mesh_compute.h"
+#include "mesh_terrain.h"
+#include "mesh_elevation.h"
+#include "mesh_tessellation.h"
+#include "mesh_instancing.h"
+#include "entity_system.h"
+#include "mesh_indirect.h"
+#include "uniform_buffers.h"
+#include "render_queue.h"
 
 /* Keep the global state inside this struct */
 static struct {
@@ -78,23 +95,6 @@ static void WindowSizeCallback(GLFWwindow* window, int width, int height)
 }
 
 
-bool CheckCollision(glm::vec3& first, glm::vec3& second) { // AABB - AABB collision
-
-	auto r = 0.0763892f; //0.0763892f     //radius of sphere
-	// collision x-axis?
-	bool collisionX = first.x + r >= second.x - r &&
-		second.x + r >= first.x - r;
-	// collision y-axis?
-	bool collisionY = first.y + r >= second.y - r &&
-		second.y + r >= first.y - r;
-	// collision z-axis?
-	bool collisionZ = first.z + r >= second.z - r &&
-		second.z + r >= first.z - r;
-	// collision only if on all axes
-	return collisionX && collisionY && collisionZ;
-}
-
-
 int main(int argc, char* argv[])
 {
 	/* Set GLFW error callback */
@@ -114,9 +114,10 @@ int main(int argc, char* argv[])
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_FALSE);
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 	glfwWindowHint(GLFW_TRANSPARENT_FRAMEBUFFER, GLFW_TRUE);
+	std::string window_title = "Efehan Guner";
 	GLFWwindow* window = glfwCreateWindow(
 		Globals.screen_dimensions.x, Globals.screen_dimensions.y,
-		"Efehan Guner", NULL, NULL
+		window_title.c_str(), NULL, NULL
 	);
 	if (!window)
 	{
@@ -151,20 +152,74 @@ int main(int argc, char* argv[])
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	/* Creating Meshes */
-	std::vector<glm::vec3> positions1;
-	std::vector<glm::vec3> normals1;
-	std::vector<glm::vec2> uvs1;
-	std::vector<GLuint> indices1;
-
-	GenerateParametricShapeFrom2D(positions1, normals1, uvs1, indices1, ParametricHalfCircle, 1024, 1024);
-	VAO sphereVAO(positions1, normals1, uvs1, indices1);
-
-	std::vector<glm::vec3> positions2;
-	std::vector<glm::vec3> normals2;
-	std::vector<glm::vec2> uvs2;
-	std::vector<GLuint> indices2;
-	GenerateParametricShapeFrom2D(positions2, normals2, uvs2, indices2, ParametricCircle, 512, 512);
-	VAO torusVAO(positions2, normals2, uvs2, indices2);
+	auto mesh_generation_start = glfwGetTime();
+
+	// Mars is textured, so the sphere keeps its texture seam, the tires are not
+	RevolutionTopology sphere_topology = { true, false };
+	RevolutionTopology torus_topology = { true, true };
+
+	// Meshes are loaded from the mesh_cache directory after the first launch. --stream-meshes turns
+	// the cache off and streams the meshes into their buffers instead, --compute-meshes generates them
+	// with compute shaders, and --validate-compute-meshes also compares those with the CPU meshes.
+	// --no-patch-culling draws every patch of the cached meshes, --no-elevation keeps the Mars terrain a sphere.
+	// --rovers N adds chasing rovers up to N rovers, the entity systems are timed in the Benchmarks project.
+	// --indirect-draws draws the LOD chains from shared buffers with one multi draw indirect per frame.
+	bool patch_culling = true;
+	bool indirect_draws = false;
+	bool elevation = true;
+	int rover_count = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		auto argument = std::string(argv[i]);
+		if (argument == "--rovers" && i + 1 < argc)
+			rover_count = std::atoi(argv[++i]);
+		if (argument == "--no-patch-culling")
+			patch_culling = false;
+		if (argument == "--no-elevation")
+			elevation = false;
+		if (argument == "--indirect-draws")
+			indirect_draws = true;
+		if (argument == "--stream-meshes" || argument == "--compute-meshes" || argument == "--validate-compute-meshes")
+			SetMeshCacheDirectory("");
+		if (argument == "--compute-meshes" || argument == "--validate-compute-meshes")
+			SetComputeGeneration(true, argument == "--validate-compute-meshes");
+	}
+
+	// The sphere and torus get as many segments as their target errors need, in mesh space
+	auto sphereLOD = GenerateLODChain(
+		ParametricHalfCircleBatch, AdaptiveSampling{ 1e-5, 8, 8 }, 7, VertexLayout::InterleavedQuantized, sphere_topology, "half_circle");
+	auto torusLOD = GenerateLODChain(
+		ParametricCircleBatch, AdaptiveSampling{ 2.5e-5, 8, 8 }, 6, VertexLayout::InterleavedQuantized, torus_topology, "circle");
+
+	// Mars is a quadtree terrain that refines around the camera, the 1, 2 and 3 keys
+	// switch to these alternative meshes with evenly spread triangles, and 4 back.
+	// The 6 key switches to a sphere whose coarser levels are simplified from its finest.
+	auto marsTerrain = CreateTerrain();
+	auto icosphereLOD = GenerateIcosphereLODChain(7, 7, VertexLayout::InterleavedQuantized);
+	auto cubeSphereLOD = GenerateCubeSphereLODChain(128, 6, VertexLayout::InterleavedQuantized);
+	auto simplifiedSphereLOD = GenerateSimplifiedLODChain(
+		ParametricHalfCircleBatch, AdaptiveSampling{ 1e-4, 8, 8 }, 7, VertexLayout::InterleavedQuantized, sphere_topology, "half_circle");
+
+	// The same sphere and torus built by the vertex shader, drawn instead of the chains after the P key
+	auto sphereProcedural = CreateProceduralMesh(ProceduralHalfCircle());
+	auto torusProcedural = CreateProceduralMesh(ProceduralCircle());
+
+	std::cout << "Meshes are created in " << (glfwGetTime() - mesh_generation_start) * 1000 << " ms" << std::endl;
+
+	auto& sphere_report = sphereLOD.levels[0].optimization_report;
+	auto& torus_report = torusLOD.levels[0].optimization_report;
+	std::cout << "Sphere ACMR: " << sphere_report.before.acmr << " -> " << sphere_report.after.acmr
+		<< " ATVR: " << sphere_report.before.atvr << " -> " << sphere_report.after.atvr << std::endl;
+	std::cout << "Torus ACMR: " << torus_report.before.acmr << " -> " << torus_report.after.acmr
+		<< " ATVR: " << torus_report.before.atvr << " -> " << torus_report.after.atvr << std::endl;
+
+	auto& sphere_topology_statistics = sphereLOD.levels[0].topology_statistics;
+	auto& torus_topology_statistics = torusLOD.levels[0].topology_statistics;
+	std::cout << "Sphere duplicate vertices: " << sphere_topology_statistics.duplicate_vertices
+		<< " degenerate triangles: " << sphere_topology_statistics.degenerate_triangles << std::endl;
+	std::cout << "Torus duplicate vertices: " << torus_topology_statistics.duplicate_vertices
+		<< " degenerate triangles: " << torus_topology_statistics.degenerate_triangles << std::endl;
+
 	/* Creating Textures */
 
 	stbi_set_flip_vertically_on_load(true);
@@ -200,7 +255,8 @@ int main(int argc, char* argv[])
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	// The map wraps around in u, triangles across the seam of the sphere meshes reach past u = 1
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 
 	glGenerateMipmap(GL_TEXTURE_2D);
@@ -211,55 +267,54 @@ int main(int argc, char* argv[])
 	stbi_image_free(texture_data);
 
 	/* Creating Programs */
-	GLuint program = CreateProgramFromSources(
-		R"VERTEX(
-#version 330 core
-
-layout(location = 0) in vec3 a_position;
-layout(location = 1) in vec3 a_normal;
-layout(location = 2) in vec2 a_uv;
 
-uniform mat4 u_model;
-uniform mat4 u_projection_view;
-
-out vec4 world_space_position;
-out vec3 world_space_normal;
-out vec2 vertex_uv;
+	// Shared with the tessellated Mars, its tessellation stages have the same outputs as the vertex shader
+	auto fragment_shader_source = R"FRAGMENT(
+#version 330 core
 
-void main()
+// See FrameUniforms in uniform_buffers.h
+layout(std140) uniform FrameUniforms
 {
-	world_space_position = u_model * vec4(a_position, 1);
-	world_space_normal = vec3(u_model * vec4(a_normal, 0));
-	vertex_uv = a_uv;
+	mat4 u_projection_view;
+	vec2 u_mouse_position;
+	float u_time;
+};
 
-	gl_Position = u_projection_view * world_space_position;
-}
-		)VERTEX",
-
-		R"FRAGMENT(
-#version 330 core
-
-uniform vec2 u_mouse_position;
 uniform sampler2D u_texture;
-uniform vec3 u_surface_color;
-uniform vec3 textured;
+uniform int u_vertex_layout;
 
 in vec4 world_space_position;
 in vec3 world_space_normal;
 in vec2 vertex_uv;
+in vec3 terrain_direction;
+flat in vec3 vertex_color;
+flat in vec3 vertex_textured;
 
 out vec4 out_color;
 
+// Same mapping as the sphere meshes. u is taken from the one of two versions, wrapping at the seam
+// or opposite to it, that changes less across the pixel, so the seam does not pick the smallest mip.
+vec2 TerrainUV(vec3 direction)
+{
+	float u = atan(-direction.z, direction.x) / 6.28318530718;
+	float u_seam = fract(u);
+	float u_opposite = fract(u + 0.5) - 0.5;
+	u = fwidth(u_seam) <= fwidth(u_opposite) ? u_seam : u_opposite;
+
+	float v = asin(clamp(direction.y, -1, 1)) / 3.14159265359 + 0.5;
+	return vec2(u, v);
+}
+
 void main()
 {
 	vec3 color = vec3(0);
 
 	vec3 surface_position = world_space_position.xyz;
 	vec3 surface_normal = normalize(world_space_normal);
-	vec2 surface_uv = vertex_uv;
+	vec2 surface_uv = u_vertex_layout == 3 ? TerrainUV(normalize(terrain_direction)) : vertex_uv;
 	vec3 texture_color = texture(u_texture, surface_uv).rgb;
-	texture_color=texture_color * textured;
-	vec3 surface_color = u_surface_color;
+	texture_color=texture_color * vertex_textured;
+	vec3 surface_color = vertex_color;
 
 	vec3 ambient_color = vec3(0.7);
 	color += ambient_color * surface_color * texture_color;
@@ -280,7 +335,243 @@ void main()
 
 	out_color = vec4(color,1);
 }
-		)FRAGMENT");
+		)FRAGMENT";
+
+	GLuint program = CreateProgramFromSources(
+		R"VERTEX(
+#version 330 core
+#extension GL_ARB_shader_draw_parameters : enable
+
+layout(location = 0) in vec3 a_position;
+layout(location = 1) in vec3 a_normal;
+layout(location = 2) in vec2 a_uv;
+
+// Instance attributes of the terrain, see TerrainInstance
+layout(location = 3) in vec4 a_terrain_node;
+layout(location = 4) in vec2 a_terrain_morph;
+
+// Instance attributes of the instanced draws, see MeshInstance
+layout(location = 5) in mat4 a_instance_model;
+layout(location = 9) in vec4 a_instance_color;
+layout(location = 10) in vec4 a_instance_wobble;
+layout(location = 11) in vec2 a_instance_wobble_timing;
+
+// Data of the frame and of the draw, see FrameUniforms and ObjectUniforms in uniform_buffers.h
+layout(std140) uniform FrameUniforms
+{
+	mat4 u_projection_view;
+	vec2 u_mouse_position;
+	float u_time;
+};
+
+layout(std140) uniform ObjectUniforms
+{
+	mat4 u_model;
+	vec3 u_surface_color;
+	vec3 textured;
+};
+
+// Model, color and textured come from the instance attributes instead of the object uniforms
+uniform bool u_instanced;
+
+// Vertex layout of the bound VAO, 0: Separate, 1: InterleavedQuantized, 2: procedural, 3: terrain
+uniform int u_vertex_layout;
+uniform vec3 u_position_scale;
+uniform vec3 u_position_offset;
+
+// Indirect draws of the shared InterleavedQuantized buffers take the position scale and offset of
+// their mesh from the draw data of gl_DrawIDARB instead, see IndirectDrawData in mesh_indirect.h
+uniform bool u_indirect;
+layout(std140) uniform IndirectDraws
+{
+	vec4 u_indirect_draws[1024];
+};
+
+// Procedural surface of revolution, see mesh_procedural.h. Segments are (vertical, rotation),
+// the profile is the arc's center, radius and angle.
+uniform ivec2 u_procedural_segments;
+uniform vec4 u_procedural_profile;
+
+// Terrain, see mesh_terrain.h. The camera is in mesh space.
+uniform vec3 u_terrain_camera;
+uniform float u_terrain_grid_segments;
+
+// Elevation of the terrain, see mesh_elevation.h. A scale of 0 leaves the sphere flat.
+uniform sampler2DArray u_elevation_pages;
+uniform usampler2DArray u_elevation_page_table;
+uniform int u_elevation_max_level;
+uniform float u_elevation_scale;
+
+out vec4 world_space_position;
+out vec3 world_space_normal;
+out vec2 vertex_uv;
+out vec3 terrain_direction;
+flat out vec3 vertex_color;
+flat out vec3 vertex_textured;
+
+vec3 OctahedralDecode(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0);
+	normal.x += normal.x >= 0 ? -fold : fold;
+	normal.y += normal.y >= 0 ? -fold : fold;
+	return normalize(normal);
+}
+
+// Vertex v of ring r of GenerateParametricShapeFrom2D. Every instance is the strip of one
+// column, its first vertex is repeated so the odd triangles keep the winding of the meshes.
+// Instanced draws go through the columns once per mesh instance.
+void ProceduralVertex(out vec3 position, out vec3 normal, out vec2 uv)
+{
+	int strip_vertex = max(gl_VertexID - 1, 0);
+	int v = strip_vertex / 2;
+	int r = gl_InstanceID % (u_procedural_segments.y - 1) + (strip_vertex & 1);
+
+	float t = float(v) / float(u_procedural_segments.x - 1);
+	float angle = (t - 0.5) * u_procedural_profile.w;
+	vec2 profile_normal = vec2(cos(angle), sin(angle));
+	vec2 profile_position = u_procedural_profile.xy + profile_normal * u_procedural_profile.z;
+
+	// Same as rotating the profile around the y axis
+	float u = float(r) / float(u_procedural_segments.y - 1);
+	float c = cos(u * 6.28318530718);
+	float s = sin(u * 6.28318530718);
+
+	position = vec3(profile_position.x * c, profile_position.y, -profile_position.x * s);
+	normal = vec3(profile_normal.x * c, profile_normal.y, -profile_normal.x * s);
+	uv = vec2(u, t);
+}
+
+// Face coordinates of a grid vertex of the node
+vec2 TerrainPoint(vec2 grid)
+{
+	return a_terrain_node.xy + grid / u_terrain_grid_segments * a_terrain_node.z;
+}
+
+// Point of the unit sphere on the node's cube face, same as TerrainFacePoint in mesh_terrain.cpp
+vec3 TerrainFacePoint(vec2 point)
+{
+	const vec3 axes[3] = vec3[3](vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1));
+	int face = int(a_terrain_node.w);
+	vec3 normal = axes[face / 2] * (face % 2 == 0 ? 1.0 : -1.0);
+	vec3 tangent = axes[(face / 2 + 1) % 3];
+	vec3 bitangent = axes[(face / 2 + 2) % 3];
+
+	vec3 cube = normal + point.x * tangent + point.y * bitangent;
+	return normalize(tan(cube * 0.785398163397));
+}
+
+// Height at the face coordinates from the finest resident page, and the distance between its samples.
+// Vertices of neighbouring nodes at the same point find the same page, so they stay together.
+float Elevation(vec2 point, out float spacing)
+{
+	int table_size = 1 << u_elevation_max_level;
+	vec2 table_point = clamp((point + 1) * 0.5, 0, 1);
+	ivec2 texel = min(ivec2(table_point * table_size), ivec2(table_size - 1));
+	uvec2 page = texelFetch(u_elevation_page_table, ivec3(texel, int(a_terrain_node.w)), 0).xy;
+
+	int level = int(page.y);
+	vec2 local = table_point * float(1 << level) - vec2(texel >> (u_elevation_max_level - level));
+	float samples = float(textureSize(u_elevation_pages, 0).x);
+	spacing = 2.0 / float(1 << level) / (samples - 1);
+	return textureLod(u_elevation_pages, vec3((local * (samples - 1) + 0.5) / samples, float(page.x)), 0).r;
+}
+
+vec3 TerrainSurfacePoint(vec2 point, out float spacing)
+{
+	return TerrainFacePoint(point) * (1 + u_elevation_scale * Elevation(point, spacing));
+}
+
+// Vertex of a terrain node. Odd vertices of the grid slide onto their even neighbours as the
+// camera moves away, until the node matches its parent where the parent would be drawn instead.
+// The normal of the displaced surface is taken across the neighbouring samples of the page.
+void TerrainVertex(out vec3 position, out vec3 normal)
+{
+	vec2 grid = a_position.xy;
+	float distance = length(TerrainFacePoint(TerrainPoint(grid)) - u_terrain_camera);
+	float morph = clamp((distance - a_terrain_morph.x) / (a_terrain_morph.y - a_terrain_morph.x), 0, 1);
+	grid -= fract(grid * 0.5) * 2 * morph;
+
+	vec2 point = TerrainPoint(grid);
+	if (u_elevation_scale == 0)
+	{
+		position = TerrainFacePoint(point);
+		normal = position;
+		return;
+	}
+
+	float spacing;
+	float unused;
+	position = TerrainSurfacePoint(point, spacing);
+	vec3 tangent = TerrainSurfacePoint(clamp(point + vec2(spacing, 0), -1, 1), unused)
+		- TerrainSurfacePoint(clamp(point - vec2(spacing, 0), -1, 1), unused);
+	vec3 bitangent = TerrainSurfacePoint(clamp(point + vec2(0, spacing), -1, 1), unused)
+		- TerrainSurfacePoint(clamp(point - vec2(0, spacing), -1, 1), unused);
+	normal = normalize(cross(tangent, bitangent));
+	normal *= sign(dot(normal, position));
+}
+
+// Same as glm::rotate
+mat3 Rotation(vec3 axis, float angle)
+{
+	float c = cos(angle);
+	float s = sin(angle);
+	mat3 cross_product = mat3(0, axis.z, -axis.y, -axis.z, 0, axis.x, axis.y, -axis.x, 0);
+	return mat3(c) + outerProduct(axis * (1 - c), axis) + s * cross_product;
+}
+
+void main()
+{
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+	if (u_vertex_layout == 2)
+		ProceduralVertex(position, normal, uv);
+	else if (u_vertex_layout == 3)
+	{
+		// The texture coordinates are found per fragment, they wrap around inside the nodes
+		TerrainVertex(position, normal);
+		uv = vec2(0);
+	}
+	else
+	{
+		vec3 position_scale = u_position_scale;
+		vec3 position_offset = u_position_offset;
+#ifdef GL_ARB_shader_draw_parameters
+		if (u_indirect)
+		{
+			position_scale = u_indirect_draws[2 * gl_DrawIDARB].xyz;
+			position_offset = u_indirect_draws[2 * gl_DrawIDARB + 1].xyz;
+		}
+#endif
+		position = a_position * position_scale + position_offset;
+		normal = u_vertex_layout == 1 ? OctahedralDecode(a_normal.xy) : a_normal;
+
+		// Quantized u is stored halved, see quantized_uv_range
+		uv = u_vertex_layout == 1 ? a_uv * vec2(2, 1) : a_uv;
+	}
+
+	mat4 model = u_model;
+	vertex_color = u_surface_color;
+	vertex_textured = textured;
+	if (u_instanced)
+	{
+		float phase = a_instance_wobble_timing.x * u_time + a_instance_wobble_timing.y;
+		float wobble = a_instance_wobble.w * (cos(phase) + sin(phase));
+		model = a_instance_model * mat4(Rotation(a_instance_wobble.xyz, wobble));
+		vertex_color = a_instance_color.rgb;
+		vertex_textured = vec3(a_instance_color.a);
+	}
+
+	world_space_position = model * vec4(position, 1);
+	world_space_normal = vec3(model * vec4(normal, 0));
+	vertex_uv = uv;
+	terrain_direction = position;
+
+	gl_Position = u_projection_view * world_space_position;
+}
+		)VERTEX",
+		fragment_shader_source);
 
 	if (program == NULL)
 	{
@@ -298,28 +589,287 @@ void main()
 
 
 
-	auto mouse_location = glGetUniformLocation(program, "u_mouse_position");
-	auto textured_location = glGetUniformLocation(program, "textured");
-	auto model_location = glGetUniformLocation(program, "u_model");
-	auto projection_view_location = glGetUniformLocation(program, "u_projection_view");
-	auto surface_color_location = glGetUniformLocation(program, "u_surface_color");
+	// Per frame data is uploaded once a frame, per object data by the render queue
+	BindUniformBlocks(program);
+	auto frameUniformBuffer = CreateFrameUniformBuffer();
+	BindEmptyIndirectDrawData();
+	FrameUniforms frame_uniforms = {};
+
+	auto procedural_segments_location = glGetUniformLocation(program, "u_procedural_segments");
+	auto procedural_profile_location = glGetUniformLocation(program, "u_procedural_profile");
+	auto terrain_camera_location = glGetUniformLocation(program, "u_terrain_camera");
+	auto terrain_grid_segments_location = glGetUniformLocation(program, "u_terrain_grid_segments");
+
+	// Elevation pages of the terrain are on texture units 1 and 2, streamed in on a worker thread
+	TerrainElevation marsElevation = {};
+	if (elevation)
+	{
+		marsElevation = CreateTerrainElevation(1);
+		marsTerrain.max_elevation = marsElevation.height_scale;
+		std::cout << "Elevation pages: " << marsElevation.page_capacity << " of "
+			<< marsElevation.page_samples << "x" << marsElevation.page_samples << " samples" << std::endl;
+	}
+	glUniform1i(glGetUniformLocation(program, "u_elevation_pages"), 1);
+	glUniform1i(glGetUniformLocation(program, "u_elevation_page_table"), 2);
+	glUniform1i(glGetUniformLocation(program, "u_elevation_max_level"), marsElevation.max_level);
+	glUniform1f(glGetUniformLocation(program, "u_elevation_scale"), marsElevation.height_scale);
+
+	// The 5 key draws Mars with tessellation shaders instead, when the GL supports them
+	TessellatedSphere marsTessellation = {};
+	if (TessellationSupported())
+		marsTessellation = CreateTessellatedSphere(fragment_shader_source);
+	if (marsTessellation.program != 0)
+	{
+		glUseProgram(marsTessellation.program);
+		glUniform1i(glGetUniformLocation(marsTessellation.program, "u_texture"), 0);
+		glUniform1i(glGetUniformLocation(marsTessellation.program, "u_vertex_layout"), 3);
+		glUseProgram(program);
+	}
+	else
+		std::cout << "Tessellation shaders are not supported, the 5 key does nothing." << std::endl;
 
 	auto camera_position = glm::vec3(0, 0, -5);
+
+	// The draws of a frame are submitted to the queue and sorted by their state when it is executed,
+	// it skips the binds and uniforms that are set already. The tessellated Mars sets its own uniforms
+	// apart from the object uniforms.
+	auto renderQueue = CreateRenderQueue();
+	RegisterRenderQueueProgram(renderQueue, program);
+	if (marsTessellation.program != 0)
+		RegisterRenderQueueProgram(renderQueue, marsTessellation.program, false);
+
+	// Every level of the chains is copied to the shared buffers, the draws of the chains add their
+	// commands there and the queue draws them all as one packet
+	IndirectMeshBuffer indirectMeshes = {};
+	if (indirect_draws && !IndirectDrawsSupported())
+	{
+		std::cout << "Indirect draws are not supported, --indirect-draws does nothing." << std::endl;
+		indirect_draws = false;
+	}
+	if (indirect_draws)
+	{
+		std::vector<const VAO*> indirect_vaos;
+		for (auto chain : { &sphereLOD, &torusLOD, &icosphereLOD, &cubeSphereLOD, &simplifiedSphereLOD })
+			for (auto& level : chain->levels)
+				indirect_vaos.push_back(&level.vao);
+		indirectMeshes = CreateIndirectMeshBuffer(indirect_vaos);
+	}
+
+	auto fov = glm::radians(45.f);
+	int frame_triangles = 0;
+	int previous_frame_triangles = 0;
+	bool procedural_mode = false;
+
+	auto projection_view = glm::mat4(1);
+	std::vector<GLsizei> patch_counts;
+	std::vector<const void*> patch_offsets;
+
+	// Packet of the main program for the VAO, with how the shader decodes its vertices
+	auto vao_packet = [&](const VAO& vao, const glm::mat4& model, GLuint packet_texture, float depth, const std::function<void()>& draw)
+	{
+		auto packet = CreateDrawPacket(program, vao.id, packet_texture, depth, draw);
+		packet.uniforms.model = model;
+		packet.uniforms.vertex_layout = int(vao.layout);
+		packet.uniforms.position_scale = vao.position_scale;
+		packet.uniforms.position_offset = vao.position_offset;
+		return packet;
+	};
+
+	// The procedural version of the chain, drawn instead of it in procedural mode
+	auto procedural_mesh_of = [&](const LODChain& chain) -> const ProceduralMesh*
+	{
+		if (&chain == &sphereLOD)
+			return &sphereProcedural;
+		if (&chain == &torusLOD)
+			return &torusProcedural;
+		return nullptr;
+	};
+
+	// Packet of the procedural mesh with these segments. Every column is an instance, the
+	// columns of a mesh instance share the attributes of an instance batch.
+	auto procedural_packet = [&](const ProceduralMesh& procedural_mesh, const glm::ivec2& segments,
+		const glm::mat4& model, GLuint packet_texture, float depth, int mesh_instance_count)
+	{
+		auto packet = CreateDrawPacket(program, procedural_mesh.vao, packet_texture, depth, [&, mesh = &procedural_mesh, segments, mesh_instance_count]()
+		{
+			auto& profile = mesh->profile;
+			SetInstanceDivisor(mesh->vao, GLuint(segments.y - 1));
+			glUniform2i(procedural_segments_location, segments.x, segments.y);
+			glUniform4f(procedural_profile_location, profile.center.x, profile.center.y, profile.radius, profile.arc_angle);
+			DrawProceduralMesh(*mesh, segments, mesh_instance_count);
+		});
+		packet.uniforms.model = model;
+		packet.uniforms.vertex_layout = 2;
+		return packet;
+	};
+
+	// Submits the level of the chain that fits the projected size of the model,
+	// lod keeps the level picked for this draw across frames. Only the patches
+	// that can be visible are drawn, meshes that contain a sphere of occluder_radius
+	// around their origin also skip the patches behind its horizon.
+	auto submit_lod = [&](const LODChain& chain, const glm::mat4& model, const glm::vec3& surface_color, bool textured,
+		int& lod, float occluder_radius = 0)
+	{
+		auto diameter = ProjectedDiameter(chain, model, camera_position, fov, Globals.screen_dimensions.y);
+		auto depth = glm::distance(camera_position, glm::vec3(model[3]));
+		auto packet_texture = textured ? texture : 0;
+		auto procedural_mesh = procedural_mesh_of(chain);
+
+		// Procedural meshes pick their segments per draw instead of a level
+		DrawPacket packet;
+		if (procedural_mode && procedural_mesh != nullptr)
+		{
+			auto segments = ProceduralSegments(*procedural_mesh, diameter);
+			packet = procedural_packet(*procedural_mesh, segments, model, packet_texture, depth, 1);
+			frame_triangles += ProceduralTriangleCount(segments);
+		}
+		else
+		{
+			lod = SelectLOD(chain, diameter, lod);
+			auto& level = chain.levels[lod];
+			auto& vao = level.vao;
+
+			// Indirect draws are of the model's instance
+			auto indirect_mesh = indirect_draws ? FindIndirectMesh(indirectMeshes, vao.id) : -1;
+			auto indirect_instance = [&]()
+			{
+				return GLuint(AddIndirectInstances(indirectMeshes, { CreateMeshInstance(model, surface_color, textured) }));
+			};
+
+			if (patch_culling && !level.patches.empty())
+			{
+				// The tessellation dips under the sphere by up to its geometric error
+				auto culling = CullMeshPatches(level.patches, model, projection_view, camera_position,
+					glm::max(occluder_radius - level.geometric_error, 0.f), patch_counts, patch_offsets);
+				frame_triangles += int(culling.visible_triangles);
+
+				// Every visible range of patches is a command
+				if (indirect_mesh >= 0)
+				{
+					auto base_instance = indirect_instance();
+					for (size_t i = 0; i < patch_counts.size(); ++i)
+						AddIndirectDraw(indirectMeshes, indirect_mesh, base_instance, 1,
+							GLuint(reinterpret_cast<size_t>(patch_offsets[i]) / sizeof(GLuint)), patch_counts[i]);
+					return;
+				}
+				packet = vao_packet(vao, model, packet_texture, depth, [counts = patch_counts, offsets = patch_offsets]()
+				{
+					glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), GLsizei(counts.size()));
+				});
+			}
+			else
+			{
+				frame_triangles += vao.element_array_count / 3;
+				if (indirect_mesh >= 0)
+				{
+					AddIndirectDraw(indirectMeshes, indirect_mesh, indirect_instance(), 1);
+					return;
+				}
+				packet = vao_packet(vao, model, packet_texture, depth, [count = vao.element_array_count]()
+				{
+					glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0);
+				});
+			}
+		}
+		packet.uniforms.surface_color = surface_color;
+		packet.uniforms.textured = glm::vec3(textured ? 1.f : 0.f);
+		SubmitDrawPacket(renderQueue, std::move(packet));
+	};
+
+	// Rover bodies and tires each go out in one instanced draw, filled from the entities every frame.
+	// The batches are attached to every level of their chains and to the procedural meshes.
+	auto roverBodies = CreateInstanceBatch();
+	auto roverTires = CreateInstanceBatch();
+	for (auto& level : sphereLOD.levels)
+		AttachInstanceBatch(roverBodies, level.vao.id);
+	for (auto& level : torusLOD.levels)
+		AttachInstanceBatch(roverTires, level.vao.id);
+	AttachInstanceBatch(roverBodies, sphereProcedural.vao);
+	AttachInstanceBatch(roverTires, torusProcedural.vao);
+	std::vector<InstanceBatch*> rover_batches = { &roverBodies, &roverTires };
+
+	// The first rover is driven by the user, the others chase it and close that part of the distance every frame
+	std::vector<RoverDescription> rover_descriptions = {
+		{ glm::vec3(0, 0, -2.2), glm::vec3(1, 0, 0), -1, 0 },
+		{ glm::vec3(0, 1.f, -2.f), glm::vec3(0, 0, 1), 0, 0.01f },
+		{ glm::vec3(-1.f, 0, -2.f), glm::vec3(1, 0, 1), 0, 0.02f }
+	};
+	auto described_rovers = rover_descriptions.size();
+
+	// Rovers of --rovers are in a grid in front of Mars, at the height of the first one
+	auto rover_grid_side = int(glm::ceil(glm::sqrt(float(rover_count))));
+	for (auto i = int(rover_descriptions.size()); i < rover_count; ++i)
+	{
+		auto cell = glm::vec2(i % rover_grid_side, i / rover_grid_side) / float(rover_grid_side);
+		auto chase_rate = 0.005f + 0.015f * glm::fract(i * 0.618034f);
+		rover_descriptions.push_back({ glm::vec3(cell * 3.f - 1.5f, -2.2f), glm::vec3(cell, 1 - cell.x), 0, chase_rate });
+	}
+
+	EntityStore entities;
+	auto rovers = CreateRovers(entities, rover_descriptions, 0, 1);
+	std::cout << "Entities: " << entities.positions.size() << " for " << rovers.size() << " rovers" << std::endl;
+
+	// Submits every instance of the batch with the level of the chain that fits the largest of them on
+	// screen, lod keeps it across frames. Patches are not culled, they are visible for some instances
+	// and not for others. The batch is uploaded now, it has to stay the same until the queue is executed.
+	// Indirect draws copy the instances instead.
+	auto submit_instanced = [&](const LODChain& chain, const InstanceBatch& batch, int& lod)
+	{
+		if (batch.instances.empty())
+			return;
+
+		auto diameter = 0.f;
+		auto depth = std::numeric_limits<float>::max();
+		for (auto& instance : batch.instances)
+		{
+			diameter = glm::max(diameter, ProjectedDiameter(chain, instance.model, camera_position, fov, Globals.screen_dimensions.y));
+			depth = glm::min(depth, glm::distance(camera_position, glm::vec3(instance.model[3])));
+		}
+		auto instance_count = GLsizei(batch.instances.size());
+		auto procedural_mesh = procedural_mesh_of(chain);
+
+		DrawPacket packet;
+		if (procedural_mode && procedural_mesh != nullptr)
+		{
+			auto segments = ProceduralSegments(*procedural_mesh, diameter);
+			UploadInstanceBatch(batch);
+			packet = procedural_packet(*procedural_mesh, segments, glm::mat4(1), 0, depth, instance_count);
+			frame_triangles += ProceduralTriangleCount(segments) * instance_count;
+		}
+		else
+		{
+			lod = SelectLOD(chain, diameter, lod);
+			auto& vao = chain.levels[lod].vao;
+			auto indirect_mesh = indirect_draws ? FindIndirectMesh(indirectMeshes, vao.id) : -1;
+			if (indirect_mesh >= 0)
+			{
+				AddIndirectDraw(indirectMeshes, indirect_mesh, GLuint(AddIndirectInstances(indirectMeshes, batch.instances)), instance_count);
+				frame_triangles += vao.element_array_count / 3 * instance_count;
+				return;
+			}
+
+			UploadInstanceBatch(batch);
+			packet = vao_packet(vao, glm::mat4(1), 0, depth, [count = vao.element_array_count, instance_count]()
+			{
+				glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0, instance_count);
+			});
+			frame_triangles += vao.element_array_count / 3 * instance_count;
+		}
+		packet.uniforms.instanced = 1;
+		SubmitDrawPacket(renderQueue, std::move(packet));
+	};
+
 	auto camera_up = glm::vec3(0, 1, 0);
 
 	bool camera_mode = false;
 	bool mode_set = false;
 	bool rover_mode = false;
 
-	auto movement = glm::vec3(0);
-	auto chasing_pos1 = glm::vec3(0, 0, 0);
-	auto chasing_pos2 = glm::vec3(0, 0, 0);
-	bool first_run = true;
-
-	bool rotate_tires1 = false;
-	bool collision = false;
-	bool collision1 = false;
-	bool collision2 = false;
+	int mars_lod = -1;
+	int rover_body_lod = -1;
+	int rover_tire_lod = -1;
+	const LODChain* mars_lod_chain = nullptr;
+	bool mars_tessellated = false;
 
 	float previous_time = glfwGetTime();
 	/* Loop until the user closes the window */
@@ -334,7 +884,7 @@ void main()
 		mouse_position.y = 1. - mouse_position.y;
 		mouse_position = mouse_position * 2. - 1.;
 
-		glUniform2fv(mouse_location, 1, glm::value_ptr(glm::vec2(mouse_position)));
+		frame_uniforms.mouse_position = glm::vec2(mouse_position);
 
 
 		//camera_front.x *= -1;
@@ -353,11 +903,34 @@ void main()
 			camera_mode = false;
 			rover_mode = true;
 		}
+		if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
+			mars_lod_chain = &sphereLOD;
+		if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+			mars_lod_chain = &icosphereLOD;
+		if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
+			mars_lod_chain = &cubeSphereLOD;
+		if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS)
+			mars_lod_chain = nullptr;
+		if (glfwGetKey(window, GLFW_KEY_6) == GLFW_PRESS)
+			mars_lod_chain = &simplifiedSphereLOD;
+		if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS
+			|| glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS
+			|| glfwGetKey(window, GLFW_KEY_6) == GLFW_PRESS)
+			mars_tessellated = false;
+		if (glfwGetKey(window, GLFW_KEY_5) == GLFW_PRESS && marsTessellation.program != 0)
+			mars_tessellated = true;
+		if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
+			procedural_mode = true;
+		if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS)
+			procedural_mode = false;
 
 		const float cameraSpeed = 0.01f; // adjust accordingly
 		auto rover_speed = 0.8f; //0.5f
 
-		if (collision1 || collision2) {
+		auto rover_velocity = glm::vec3(0);
+		bool rotate_tires1 = false;
+
+		if (entities.collided[rovers[0]]) {
 			rover_speed = 0.f;
 			std::cout << ("User controlled rover has collided and stopped please restart the program if you want to move it") << std::endl; //debug
 
@@ -375,7 +948,7 @@ void main()
 			if (rover_mode)
 				//movement += rover_speed * glm::vec3(0, 0, 0.1f);
 			{
-				movement += delta_time * glm::vec3(0, 0, rover_speed);
+				rover_velocity += glm::vec3(0, 0, rover_speed);
 				rotate_tires1 = true;
 			}
 
@@ -386,7 +959,7 @@ void main()
 			if (rover_mode)
 				//movement += rover_speed * glm::vec3(0, 0, -0.1f);
 			{
-				movement += delta_time * glm::vec3(0, 0, -rover_speed);
+				rover_velocity += glm::vec3(0, 0, -rover_speed);
 				rotate_tires1 = true;
 			}
 		}
@@ -396,7 +969,7 @@ void main()
 			if (rover_mode)
 				//movement += rover_speed * glm::vec3(-0.1f, 0, 0);
 			{
-				movement += delta_time * glm::vec3(-rover_speed, 0, 0);
+				rover_velocity += glm::vec3(-rover_speed, 0, 0);
 				rotate_tires1 = true;
 			}
 		}
@@ -406,7 +979,7 @@ void main()
 			if (rover_mode)
 				//movement += rover_speed * glm::vec3(0.1f, 0, 0);
 			{
-				movement += delta_time * glm::vec3(rover_speed, 0, 0);
+				rover_velocity += glm::vec3(rover_speed, 0, 0);
 				rotate_tires1 = true;
 			}
 		}
@@ -435,19 +1008,55 @@ void main()
 			camera_position + camera_front,
 			camera_up
 		);
-		auto projection = glm::perspective(glm::radians(45.f), 1.f, 0.1f, 10.f); //far was 10.f
+		auto projection = glm::perspective(fov, 1.f, 0.1f, 10.f); //far was 10.f
 
-		glUniformMatrix4fv(projection_view_location, 1, GL_FALSE, glm::value_ptr(projection * view));
+		projection_view = projection * view;
+		frame_uniforms.projection_view = projection_view;
 
 
 		//generate mars
 		auto scale = glm::scale(glm::vec3(2.f));
 		auto transform = scale;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(1, 1, 1)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(1)));
-		glBindVertexArray(sphereVAO.id);
-		glDrawElements(GL_TRIANGLES, sphereVAO.element_array_count, GL_UNSIGNED_INT, 0);
+		auto mars_depth = glm::distance(camera_position, glm::vec3(transform[3]));
+		if (mars_tessellated)
+		{
+			// The triangles are only known once it is drawn
+			auto packet = CreateDrawPacket(marsTessellation.program, marsTessellation.vao, texture, mars_depth, [&, transform]()
+			{
+				frame_triangles += DrawTessellatedSphere(marsTessellation, transform, projection_view, camera_position, fov, Globals.screen_dimensions.y);
+			});
+			packet.uniforms.model = transform;
+			packet.uniforms.textured = glm::vec3(1);
+			SubmitDrawPacket(renderQueue, std::move(packet));
+		}
+		else if (mars_lod_chain != nullptr)
+			submit_lod(*mars_lod_chain, transform, glm::vec3(1), true, mars_lod, 1.f);
+		else
+		{
+			// Pages are streamed around the camera and the described rovers, which are where they were last frame
+			if (elevation)
+			{
+				auto to_mesh = glm::inverse(transform);
+				std::vector<glm::vec3> focus_points = { glm::vec3(to_mesh * glm::vec4(camera_position, 1)) };
+				for (size_t i = 0; i < described_rovers; ++i)
+					focus_points.push_back(glm::vec3(to_mesh * glm::vec4(entities.world_positions[rovers[i]], 1)));
+				UpdateTerrainElevation(marsElevation, focus_points);
+			}
+
+			auto terrain_report = SelectTerrainNodes(marsTerrain, transform, projection_view, camera_position);
+			auto terrain_camera = glm::vec3(glm::inverse(transform) * glm::vec4(camera_position, 1));
+			auto packet = CreateDrawPacket(program, marsTerrain.vao, texture, mars_depth, [&, terrain_camera]()
+			{
+				glUniform3fv(terrain_camera_location, 1, glm::value_ptr(terrain_camera));
+				glUniform1f(terrain_grid_segments_location, float(marsTerrain.grid_segments));
+				DrawTerrain(marsTerrain);
+			});
+			packet.uniforms.model = transform;
+			packet.uniforms.textured = glm::vec3(1);
+			packet.uniforms.vertex_layout = 3;
+			SubmitDrawPacket(renderQueue, std::move(packet));
+			frame_triangles += terrain_report.triangle_count;
+		}
 
 
 		////rover movement
@@ -469,228 +1078,45 @@ void main()
 		//auto rover_move = glm::translate(movement);
 		//auto moving_angle = glm::translate(movement);
 
-		auto rover_scale = glm::scale(glm::vec3(0.08f));
-		auto init_rover_pos = glm::vec3(0, 0, -2.2);
-		auto rover_pos = init_rover_pos + movement;
-
-		//std::cout << rover_pos.x << " " << rover_pos.y << " " << rover_pos.z << std::endl; //debug
-
-		auto rover_move = glm::translate(rover_pos);
-		//auto general_rover_transform = rover_translate * rover_scale;
-		auto transform_rover = rover_move * rover_scale;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(1, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(sphereVAO.id);
-		glDrawElements(GL_TRIANGLES, sphereVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		//tires
-
-		scale = glm::scale(glm::vec3(0.015f));
-		auto tire_translate = glm::translate(glm::vec3(0.05, -0.07, 0.02));
-		auto rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if(rotate_tires1)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		auto transform_rover_tire = rover_move * tire_translate * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(-0.05, -0.07, 0.02));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rotate_tires1)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = rover_move * tire_translate * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(0.05, -0.07, -0.04));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rotate_tires1)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = rover_move * tire_translate * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(-0.05, -0.07, -0.04));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rotate_tires1)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = rover_move * tire_translate * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		//generate two catching rovers
-
-		//first one
-		auto rover2_offset = glm::vec3(0, 1.f, 0.2f) + init_rover_pos; //(0, 1.f, -0.3)
-
-		if (first_run)
-			chasing_pos1 = rover2_offset;
-		auto chasing_move1 = glm::translate(chasing_pos1);
-		if (rover_mode && !collision1) {
-			chasing_pos1 = glm::mix(rover_pos, chasing_pos1, 0.99);
-		}
-
-		//auto translate_offset = glm::translate(glm::vec3(0, 0.5f, 0) + init_rover_pos);
-		auto rover2_move = glm::translate(chasing_pos1);
-		auto transform_rover2 = rover2_move * rover_scale;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover2));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 1)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(sphereVAO.id);
-		glDrawElements(GL_TRIANGLES, sphereVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-
-		//tires
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(0.05, -0.07, 0.02));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rover_mode)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = tire_translate * rover2_move * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(-0.05, -0.07, 0.02));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rover_mode)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = tire_translate * rover2_move * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(0.05, -0.07, -0.04));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rover_mode)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = tire_translate * rover2_move * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(-0.05, -0.07, -0.04));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rover_mode)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = tire_translate * rover2_move * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		if (CheckCollision(rover_pos, chasing_pos1)) {
-			std::cout << ("Collision detected from first chasing rover!!!") << std::endl; //debug
-			collision1 = true;
-
-		}
-
-		//second catching rover
-		auto rover3_offset = glm::vec3(-1.f, 0, 0.2) + init_rover_pos;
+		// The user drives the first rover, the others only chase it in rover mode
+		entities.velocities[rovers[0]] = rover_velocity;
+		entities.driving[rovers[0]] = rotate_tires1;
+		IntegrateVelocities(entities, delta_time);
+		UpdateWorldPositions(entities);
+		ChaseTargets(entities, rover_mode);
+		UpdateWorldPositions(entities);
+		auto caught = DetectCollisions(entities);
+		FillInstanceBatches(entities, rover_batches);
 
-		if (first_run)
-			chasing_pos2 = rover3_offset;
-		auto chasing_move2 = glm::translate(chasing_pos2);
-		if (rover_mode && !collision2) {
-			chasing_pos2 = glm::mix(rover_pos, chasing_pos2, 0.98);
-		}
+		for (int i = 0; i < caught; ++i)
+			std::cout << ("Collision detected from chasing rover!!!") << std::endl; //debug
 
-		auto rover3_move = glm::translate(chasing_pos2);
-		auto transform_rover3 = rover3_move * rover_scale;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover3));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(1, 0, 1)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(sphereVAO.id);
-		glDrawElements(GL_TRIANGLES, sphereVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		//tires
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(0.05, -0.07, 0.02));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if(rover_mode)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = tire_translate * rover3_move * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(-0.05, -0.07, 0.02));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rover_mode)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = tire_translate * rover3_move * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(0.05, -0.07, -0.04));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rover_mode)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = tire_translate * rover3_move * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		scale = glm::scale(glm::vec3(0.015f));
-		tire_translate = glm::translate(glm::vec3(-0.05, -0.07, -0.04));
-		rotate = glm::rotate(glm::radians(float(90)), glm::vec3(0, 0, 1));
-		if (rover_mode)
-			rotate *= glm::rotate(glm::radians(float(cos(glfwGetTime() * 40) + sin(glfwGetTime() * 40)) * 10), glm::vec3(0.1, 0, 0.1));
-		transform_rover_tire = tire_translate * rover3_move * scale * rotate;
-		glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(transform_rover_tire));
-		glUniform3fv(surface_color_location, 1, glm::value_ptr(glm::vec3(0, 0, 0)));
-		glUniform3fv(textured_location, 1, glm::value_ptr(glm::vec3(0)));
-		glBindVertexArray(torusVAO.id);
-		glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, 0);
-
-		if (CheckCollision(rover_pos, chasing_pos2)) {
-			std::cout << ("Collision detected from second chasing rover!!!") << std::endl; //debug
-			collision2 = true;
+		submit_instanced(sphereLOD, roverBodies, rover_body_lod);
+		submit_instanced(torusLOD, roverTires, rover_tire_lod);
 
+		// The draws of the shared buffers decode their positions with the draw data instead of the uniforms
+		if (!indirectMeshes.commands.empty())
+		{
+			auto packet = CreateDrawPacket(program, indirectMeshes.vao, texture, 0, [&]()
+			{
+				DrawIndirect(indirectMeshes);
+			});
+			packet.uniforms.vertex_layout = int(VertexLayout::InterleavedQuantized);
+			packet.uniforms.instanced = 1;
+			packet.uniforms.indirect = 1;
+			SubmitDrawPacket(renderQueue, std::move(packet));
 		}
 
+		frame_uniforms.time = float(glfwGetTime());
+		UploadFrameUniforms(frameUniformBuffer, frame_uniforms);
+		ExecuteRenderQueue(renderQueue);
 
+		// In the title instead of the console, it changes with every LOD switch
+		if (frame_triangles != previous_frame_triangles)
+			glfwSetWindowTitle(window, (window_title + " - " + std::to_string(frame_triangles) + " triangles").c_str());
+		previous_frame_triangles = frame_triangles;
+		frame_triangles = 0;
 
-
-		first_run = false;
-		rotate_tires1 = false;
 		/* Swap front and back buffers */
 		glfwSwapBuffers(window);
 
@@ -699,6 +1125,9 @@ void main()
 		glfwPollEvents();
 	}
 
+	if (elevation)
+		DestroyTerrainElevation(marsElevation);
+
 	glfwTerminate();
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "mesh_cache.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mesh_generator_version.h"
+
+/* Mesh Cache Constants */
+
+// Bump when MeshCacheHeader or the file layout changes
+static const GLuint mesh_cache_format_version = 2;
+static const char mesh_cache_magic[4] = { 'M', 'E', 'S', 'H' };
+
+// Hash of the sources of the generators, their optimization, simplification, LOD errors, patches
+// and vertex layouts, written at build time, so the cached meshes are made again when they change
+static const GLuint mesh_generator_version = MESH_GENERATOR_VERSION;
+
+static std::string mesh_cache_directory = "mesh_cache";
+
+/* Helper Functions */
+
+static std::string MeshCachePath(const std::string& key)
+{
+	return mesh_cache_directory + "/" + key + ".mesh";
+}
+
+static size_t VertexDataSize(GLuint layout, GLuint vertex_count)
+{
+	if (layout == GLuint(VertexLayout::Separate))
+		return size_t(vertex_count) * (2 * sizeof(glm::vec3) + sizeof(glm::vec2));
+	return size_t(vertex_count) * sizeof(QuantizedVertex);
+}
+
+// Every index names a vertex and every patch is inside the indices, so a corrupt file is never drawn from
+static bool CachedMeshInRange(const MeshCacheHeader& header, const GLuint* indices, const MeshPatch* patches)
+{
+	for (GLuint i = 0; i < header.index_count; ++i)
+		if (indices[i] >= header.vertex_count)
+			return false;
+
+	for (GLuint i = 0; i < header.patch_count; ++i)
+		if (patches[i].first_index > header.index_count || patches[i].index_count > header.index_count - patches[i].first_index)
+			return false;
+	return true;
+}
+
+/* Mesh Cache Functions */
+void SetMeshCacheDirectory(const std::string& directory)
+{
+	mesh_cache_directory = directory;
+}
+
+bool MeshCacheEnabled()
+{
+	return !mesh_cache_directory.empty();
+}
+
+bool MapCachedMesh(const std::string& key, MappedMesh& mesh)
+{
+	if (!MeshCacheEnabled())
+		return false;
+
+	auto path = MeshCachePath(key);
+
+#ifdef _WIN32
+	auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < LONGLONG(sizeof(MeshCacheHeader)))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	auto mapping_handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	auto mapping = mapping_handle ? MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (mapping == NULL)
+	{
+		if (mapping_handle)
+			CloseHandle(mapping_handle);
+		CloseHandle(file);
+		return false;
+	}
+
+	mesh.file_handle = file;
+	mesh.mapping_handle = mapping_handle;
+	mesh.mapping = mapping;
+	mesh.mapping_size = size_t(file_size.QuadPart);
+#else
+	auto file_descriptor = open(path.c_str(), O_RDONLY);
+	if (file_descriptor < 0)
+		return false;
+
+	struct stat file_status;
+	if (fstat(file_descriptor, &file_status) != 0 || file_status.st_size < off_t(sizeof(MeshCacheHeader)))
+	{
+		close(file_descriptor);
+		return false;
+	}
+
+	auto mapping = mmap(NULL, size_t(file_status.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	if (mapping == MAP_FAILED)
+	{
+		close(file_descriptor);
+		return false;
+	}
+
+	mesh.file_descriptor = file_descriptor;
+	mesh.mapping = mapping;
+	mesh.mapping_size = size_t(file_status.st_size);
+#endif
+
+	std::memcpy(&mesh.header, mesh.mapping, sizeof(MeshCacheHeader));
+	auto& header = mesh.header;
+
+	auto vertex_data_size = VertexDataSize(header.layout, header.vertex_count);
+	auto index_data_size = size_t(header.index_count) * sizeof(GLuint);
+	auto expected_size = sizeof(MeshCacheHeader) + vertex_data_size + index_data_size + size_t(header.patch_count) * sizeof(MeshPatch);
+	if (std::memcmp(header.magic, mesh_cache_magic, sizeof(mesh_cache_magic)) != 0
+		|| header.format_version != mesh_cache_format_version
+		|| header.generator_version != mesh_generator_version
+		|| header.layout > GLuint(VertexLayout::InterleavedQuantized)
+		|| mesh.mapping_size != expected_size)
+	{
+		UnmapCachedMesh(mesh);
+		return false;
+	}
+
+	// The data is used in place, nothing is copied out of the mapping
+	auto vertices = static_cast<const char*>(mesh.mapping) + sizeof(MeshCacheHeader);
+	auto indices = reinterpret_cast<const GLuint*>(vertices + vertex_data_size);
+	auto patches = reinterpret_cast<const MeshPatch*>(vertices + vertex_data_size + index_data_size);
+	if (!CachedMeshInRange(header, indices, patches))
+	{
+		std::cout << "Mesh cache file " << path << " has indices out of range, the mesh is made again." << std::endl;
+		UnmapCachedMesh(mesh);
+		return false;
+	}
+
+	VertexData data = {};
+	data.layout = VertexLayout(header.layout);
+	data.vertex_count = GLsizei(header.vertex_count);
+	data.index_count = GLsizei(header.index_count);
+	data.position_scale = header.position_scale;
+	data.position_offset = header.position_offset;
+	data.indices = indices;
+
+	if (data.layout == VertexLayout::Separate)
+	{
+		data.positions = reinterpret_cast<const glm::vec3*>(vertices);
+		data.normals = data.positions + header.vertex_count;
+		data.uvs = reinterpret_cast<const glm::vec2*>(data.normals + header.vertex_count);
+	}
+	else
+		data.quantized_vertices = reinterpret_cast<const QuantizedVertex*>(vertices);
+
+	mesh.data = data;
+	mesh.patches = patches;
+	return true;
+}
+
+void UnmapCachedMesh(MappedMesh& mesh)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(mesh.mapping);
+	CloseHandle(mesh.mapping_handle);
+	CloseHandle(mesh.file_handle);
+#else
+	munmap(const_cast<void*>(mesh.mapping), mesh.mapping_size);
+	close(mesh.file_descriptor);
+#endif
+	mesh.mapping = nullptr;
+	mesh.mapping_size = 0;
+}
+
+bool WriteCachedMesh(const std::string& key, MeshCacheHeader header, const VertexData& data, const std::vector<MeshPatch>& patches)
+{
+	if (!MeshCacheEnabled())
+		return false;
+
+#ifdef _WIN32
+	_mkdir(mesh_cache_directory.c_str());
+#else
+	mkdir(mesh_cache_directory.c_str(), 0755);
+#endif
+
+	std::memcpy(header.magic, mesh_cache_magic, sizeof(mesh_cache_magic));
+	header.format_version = mesh_cache_format_version;
+	header.generator_version = mesh_generator_version;
+	header.layout = GLuint(data.layout);
+	header.vertex_count = GLuint(data.vertex_count);
+	header.index_count = GLuint(data.index_count);
+	header.patch_count = GLuint(patches.size());
+	header.position_scale = data.position_scale;
+	header.position_offset = data.position_offset;
+
+	// Written next to the cache file and renamed once complete, so a crash never leaves a partial file behind
+	auto path = MeshCachePath(key);
+	auto temporary_path = path + ".tmp";
+	auto file = std::fopen(temporary_path.c_str(), "wb");
+	if (file == NULL)
+	{
+		std::cout << "Mesh cache file " << temporary_path << " could not be created." << std::endl;
+		return false;
+	}
+
+	auto written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+	if (data.layout == VertexLayout::Separate)
+	{
+		written = written && std::fwrite(data.positions, sizeof(glm::vec3), data.vertex_count, file) == size_t(data.vertex_count);
+		written = written && std::fwrite(data.normals, sizeof(glm::vec3), data.vertex_count, file) == size_t(data.vertex_count);
+		written = written && std::fwrite(data.uvs, sizeof(glm::vec2), data.vertex_count, file) == size_t(data.vertex_count);
+	}
+	else
+		written = written && std::fwrite(data.quantized_vertices, sizeof(QuantizedVertex), data.vertex_count, file) == size_t(data.vertex_count);
+	written = written && std::fwrite(data.indices, sizeof(GLuint), data.index_count, file) == size_t(data.index_count);
+	written = written && std::fwrite(patches.data(), sizeof(MeshPatch), patches.size(), file) == patches.size();
+	written = std::fclose(file) == 0 && written;
+
+	std::remove(path.c_str());
+	if (!written || std::rename(temporary_path.c_str(), path.c_str()) != 0)
+	{
+		std::cout << "Mesh cache file " << path << " could not be written." << std::endl;
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+
+	return true;
+}
\ No newline at end of file
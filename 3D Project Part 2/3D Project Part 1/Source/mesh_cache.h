@@ -0,0 +1,67 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "opengl_utilities.h"
+#include "mesh_optimization.h"
+#include "mesh_culling.h"
+
+/* Mesh Cache Structs */
+
+// A cache file is this header followed by the vertex data of the layout and then the indices,
+// exactly as they are uploaded, and then the patches. Every part starts at a multiple of 4 bytes.
+struct MeshCacheHeader
+{
+	char magic[4];
+	GLuint format_version;
+
+	// Version of the code that generated the mesh, bumped by hand in mesh_cache.cpp
+	GLuint generator_version;
+
+	GLuint layout;
+	GLuint vertex_count;
+	GLuint index_count;
+	GLuint patch_count;
+	glm::vec3 position_scale;
+	glm::vec3 position_offset;
+
+	// What the generator reported about the mesh, so a cache hit does not need to recompute it
+	float bounding_radius;
+	float geometric_error;
+	MeshOptimizationReport optimization_report;
+	TopologyStatistics topology_statistics;
+};
+
+// A cache file mapped into memory, data points into the mapping and stays valid until it is unmapped
+struct MappedMesh
+{
+	MeshCacheHeader header;
+	VertexData data;
+	const MeshPatch* patches;
+
+	const void* mapping;
+	size_t mapping_size;
+#ifdef _WIN32
+	void* file_handle;
+	void* mapping_handle;
+#else
+	int file_descriptor;
+#endif
+};
+
+/* Mesh Cache Functions */
+
+// Files are stored as <directory>/<key>.mesh, an empty directory turns the cache off
+void SetMeshCacheDirectory(const std::string& directory);
+bool MeshCacheEnabled();
+
+// Returns false when the file is missing, truncated, was written by another generator version,
+// or has indices out of range
+bool MapCachedMesh(const std::string& key, MappedMesh& mesh);
+void UnmapCachedMesh(MappedMesh& mesh);
+
+// header.magic, format_version and generator_version are filled in, the rest is taken from header, data and patches
+bool WriteCachedMesh(const std::string& key, MeshCacheHeader header, const VertexData& data, const std::vector<MeshPatch>& patches);
\ No newline at end of file
@@ -0,0 +1,503 @@
+#include "mesh_compute.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mesh_streaming.h"
+
+/* Compute Generation Constants */
+
+static const int work_group_size = 64;
+
+static bool compute_generation_enabled = false;
+static bool compute_validation_enabled = false;
+
+// Compute shaders are core in GL 4.3, the extensions bring them to the 3.3 context the window asks for
+static const char* compute_shader_header = R"COMPUTE(
+#version 330 core
+#extension GL_ARB_compute_shader : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_packing : require
+
+layout(local_size_x = 64) in;
+
+const float PI = 3.14159265359;
+)COMPUTE";
+
+static const char* parametric_half_circle_source = R"COMPUTE(
+void ParametricLine(float t, out vec2 position, out vec2 tangent)
+{
+	float angle = (t - 0.5) * PI;
+	position = vec2(cos(angle), sin(angle));
+	tangent = vec2(-sin(angle), cos(angle)) * PI;
+}
+)COMPUTE";
+
+static const char* parametric_circle_source = R"COMPUTE(
+void ParametricLine(float t, out vec2 position, out vec2 tangent)
+{
+	vec2 c = vec2(0.7, 0);
+	float r = 0.3;
+
+	float angle = (t - 0.5) * 2 * PI;
+	position = vec2(cos(angle), sin(angle)) * r + c;
+	tangent = vec2(-sin(angle), cos(angle)) * r * 2 * PI;
+}
+)COMPUTE";
+
+static const char* parametric_spikes_source = R"COMPUTE(
+void ParametricLine(float t, out vec2 position, out vec2 tangent)
+{
+	vec2 c = vec2(0.7, 0);
+	float r = 0.3;
+	float a = 2 + 4 * 2;
+
+	float angle = (t - 0.5) * 2 * PI;
+	position = vec2(cos(angle) + sin(a * angle) / a, sin(angle) + cos(a * angle) / a) * r + c;
+	tangent = vec2(-sin(angle) + cos(a * angle), cos(angle) - sin(a * angle)) * r * 2 * PI;
+}
+)COMPUTE";
+
+// profile[v] = (position, tangent) at t = v / (u_vertical_segments - 1)
+static const char* profile_shader_source = R"COMPUTE(
+layout(std430, binding = 0) writeonly buffer Profile { vec4 profile[]; };
+
+uniform int u_vertical_segments;
+
+void main()
+{
+	int v = int(gl_GlobalInvocationID.x);
+	if (v >= u_vertical_segments)
+		return;
+
+	vec2 position, tangent;
+	ParametricLine(float(v) / float(u_vertical_segments - 1), position, tangent);
+	profile[v] = vec4(position, tangent);
+}
+)COMPUTE";
+
+// Vertex v of ring r, see WriteRevolutionRing. x runs over the rows of a ring, y over the rings.
+static const char* ring_shader_source = R"COMPUTE(
+layout(std430, binding = 0) readonly buffer Profile { vec4 profile[]; };
+
+#ifdef QUANTIZED
+layout(std430, binding = 1) writeonly buffer Vertices { uint vertices[]; };
+#else
+layout(std430, binding = 1) writeonly buffer Positions { float positions[]; };
+layout(std430, binding = 2) writeonly buffer Normals { float normals[]; };
+layout(std430, binding = 3) writeonly buffer UVs { vec2 uvs[]; };
+#endif
+
+uniform int u_vertical_segments;
+uniform int u_rotation_segments;
+uniform int u_first_row;
+uniform int u_end_row;
+uniform int u_ring_vertex_count;
+uniform float u_axis_tolerance;
+uniform vec3 u_position_scale;
+uniform vec3 u_position_offset;
+
+vec2 OctahedralEncode(vec3 normal)
+{
+	vec3 n = normal / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+	vec2 encoded = n.xy;
+	if (n.z < 0)
+		encoded = (1 - abs(n.yx)) * vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+	return encoded;
+}
+
+void main()
+{
+	int v = u_first_row + int(gl_GlobalInvocationID.x);
+	int r = int(gl_GlobalInvocationID.y);
+	if (v >= u_end_row)
+		return;
+
+	// Matches the orientation of cross(tangent_r, tangent_v) on the surface, see PlanRevolution
+	vec4 sample = profile[v];
+	vec2 profile_normal = vec2(sample.w, -sample.z);
+	if (sample.x < -u_axis_tolerance)
+		profile_normal = -profile_normal;
+	profile_normal = normalize(profile_normal);
+
+	float u = float(r) / float(u_rotation_segments - 1);
+	float c = cos(u * 2 * PI);
+	float s = sin(u * 2 * PI);
+
+	vec3 position = vec3(sample.x * c, sample.y, -sample.x * s);
+	vec3 normal = vec3(profile_normal.x * c, profile_normal.y, -profile_normal.x * s);
+	vec2 uv = vec2(u, float(v) / float(u_vertical_segments - 1));
+
+	int index = r * u_ring_vertex_count + v - u_first_row;
+#ifdef QUANTIZED
+	vec3 unit_position = (position - u_position_offset) / u_position_scale;
+	vertices[index * 4 + 0] = packUnorm2x16(unit_position.xy);
+	vertices[index * 4 + 1] = packUnorm2x16(vec2(unit_position.z, 0));
+	vertices[index * 4 + 2] = packSnorm2x16(OctahedralEncode(normal));
+
+	// Halved u like QuantizeVertex, see quantized_uv_range
+	vertices[index * 4 + 3] = packUnorm2x16(uv / vec2(2, 1));
+#else
+	positions[index * 3 + 0] = position.x;
+	positions[index * 3 + 1] = position.y;
+	positions[index * 3 + 2] = position.z;
+	normals[index * 3 + 0] = normal.x;
+	normals[index * 3 + 1] = normal.y;
+	normals[index * 3 + 2] = normal.z;
+	uvs[index] = uv;
+#endif
+}
+)COMPUTE";
+
+// Triangles of quad v of column r, see WriteRevolutionTriangles. x runs over the quads of a column, y over the columns.
+static const char* triangle_shader_source = R"COMPUTE(
+layout(std430, binding = 0) writeonly buffer Indices { uint indices[]; };
+
+uniform int u_vertical_segments;
+uniform int u_rotation_segments;
+uniform int u_first_pole;
+uniform int u_last_pole;
+uniform int u_closed_profile;
+uniform int u_first_row;
+uniform int u_ring_vertex_count;
+uniform int u_ring_count;
+uniform int u_pole_base;
+uniform int u_pole_vertex_count;
+uniform int u_column_triangle_count;
+
+uint VertexIndex(int v, int r, int column)
+{
+	if (v == 0 && u_first_pole != 0)
+		return uint(u_pole_base + column % u_pole_vertex_count);
+	if (v == u_vertical_segments - 1 && u_last_pole != 0)
+		return uint(u_pole_base + u_first_pole * u_pole_vertex_count + column % u_pole_vertex_count);
+	if (v == u_vertical_segments - 1 && u_closed_profile != 0)
+		v = 0;
+	return uint((r % u_ring_count) * u_ring_vertex_count + v - u_first_row);
+}
+
+void main()
+{
+	int v = int(gl_GlobalInvocationID.x);
+	int r = int(gl_GlobalInvocationID.y);
+	if (v >= u_vertical_segments - 1)
+		return;
+
+	// The first quad of a column loses a triangle at a pole
+	uint offset = uint(r * u_column_triangle_count * 3 + 3 * (2 * v - (u_first_pole != 0 && v > 0 ? 1 : 0)));
+
+	if (v != 0 || u_first_pole == 0)
+	{
+		indices[offset++] = VertexIndex(v + 1, r, r);
+		indices[offset++] = VertexIndex(v, r + 1, r);
+		indices[offset++] = VertexIndex(v, r, r);
+	}
+
+	if (v != u_vertical_segments - 2 || u_last_pole == 0)
+	{
+		indices[offset++] = VertexIndex(v + 1, r, r);
+		indices[offset++] = VertexIndex(v + 1, r + 1, r);
+		indices[offset++] = VertexIndex(v, r + 1, r);
+	}
+}
+)COMPUTE";
+
+/* Helper Functions */
+
+// Programs are built on first use and kept for the lifetime of the context, 0 for one that did not build
+static GLuint ComputeProgram(const std::string& source)
+{
+	static std::map<std::string, GLuint> programs;
+
+	auto found = programs.find(source);
+	if (found != programs.end())
+		return found->second;
+
+	auto program = CreateComputeProgramFromSource((compute_shader_header + source).c_str());
+	programs[source] = program;
+	return program;
+}
+
+static GLuint WorkGroupCount(int invocation_count)
+{
+	return GLuint((invocation_count + work_group_size - 1) / work_group_size);
+}
+
+template <typename T>
+static std::vector<T> ReadBuffer(GLenum target, GLuint buffer, size_t count)
+{
+	std::vector<T> data(count);
+	glBindBuffer(target, buffer);
+	glGetBufferSubData(target, 0, GLsizeiptr(count * sizeof(T)), data.data());
+	return data;
+}
+
+/* Compute Generation Functions */
+bool ComputeGenerationSupported()
+{
+	return GLAD_GL_ARB_compute_shader && GLAD_GL_ARB_shader_storage_buffer_object && GLAD_GL_ARB_shading_language_packing;
+}
+
+void SetComputeGeneration(bool enabled, bool validate)
+{
+	if (enabled && !ComputeGenerationSupported())
+		std::cout << "Compute shaders are not supported, meshes are generated on the CPU." << std::endl;
+
+	compute_generation_enabled = enabled;
+	compute_validation_enabled = validate;
+}
+
+bool ComputeGenerationEnabled()
+{
+	return compute_generation_enabled && ComputeGenerationSupported();
+}
+
+bool ComputeValidationEnabled()
+{
+	return compute_validation_enabled;
+}
+
+const char* ParametricLineSource(ParametricLineBatch parametric_line)
+{
+	if (parametric_line == ParametricHalfCircleBatch)
+		return parametric_half_circle_source;
+	if (parametric_line == ParametricCircleBatch)
+		return parametric_circle_source;
+	if (parametric_line == ParametricSpikesBatch)
+		return parametric_spikes_source;
+	return nullptr;
+}
+
+VAO ComputeParametricShapeFrom2D(
+	ParametricLineBatch parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	VertexLayout layout,
+	RevolutionTopology topology,
+	float* bounding_radius
+)
+{
+	auto parametric_line_source = ParametricLineSource(parametric_line);
+	GLuint profile_program = 0, ring_program = 0, triangle_program = 0;
+	if (parametric_line_source != nullptr)
+	{
+		profile_program = ComputeProgram(std::string(parametric_line_source) + profile_shader_source);
+		ring_program = ComputeProgram((layout == VertexLayout::Separate ? "" : "#define QUANTIZED\n") + std::string(ring_shader_source));
+		triangle_program = ComputeProgram(triangle_shader_source);
+	}
+
+	// A program that did not build turns compute generation off, that mesh and the ones after it are streamed from the CPU
+	if (parametric_line_source != nullptr && (profile_program == 0 || ring_program == 0 || triangle_program == 0))
+	{
+		std::cout << "Compute shaders could not be built, meshes are generated on the CPU." << std::endl;
+		compute_generation_enabled = false;
+	}
+
+	if (profile_program == 0 || ring_program == 0 || triangle_program == 0)
+	{
+		MeshStreamingReport streaming_report = {};
+		auto vao = StreamParametricShapeFrom2D(
+			parametric_line, vertical_segments, rotation_segments, layout, topology, 1 << 20, &streaming_report);
+		if (bounding_radius != nullptr)
+			*bounding_radius = streaming_report.bounding_radius;
+		return vao;
+	}
+
+	GLint previous_program;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+
+	// Profile, read back to plan the topology
+	GLuint profile_buffer;
+	glGenBuffers(1, &profile_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, profile_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, vertical_segments * sizeof(glm::vec4), NULL, GL_STATIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, profile_buffer);
+
+	glUseProgram(profile_program);
+	glUniform1i(glGetUniformLocation(profile_program, "u_vertical_segments"), vertical_segments);
+	glDispatchCompute(WorkGroupCount(vertical_segments), 1, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	auto samples = ReadBuffer<glm::vec4>(GL_SHADER_STORAGE_BUFFER, profile_buffer, vertical_segments);
+	std::vector<ParametricLineSample> profile(vertical_segments);
+	std::vector<double> profile_t(vertical_segments);
+	for (int v = 0; v < vertical_segments; ++v)
+	{
+		profile[v].position = glm::dvec2(samples[v].x, samples[v].y);
+		profile[v].tangent = glm::dvec2(samples[v].z, samples[v].w);
+		profile_t[v] = v / double(vertical_segments - 1);
+	}
+
+	auto plan = detail::PlanRevolution(profile, profile_t, rotation_segments, topology);
+
+	// Null data only allocates the buffers
+	VertexData data = {};
+	data.layout = layout;
+	data.vertex_count = GLsizei(plan.vertex_count);
+	data.index_count = GLsizei(plan.index_count);
+	QuantizationBounds(
+		glm::vec3(-plan.max_radius, plan.min_y, -plan.max_radius),
+		glm::vec3(plan.max_radius, plan.max_y, plan.max_radius),
+		data.position_scale, data.position_offset);
+
+	VAO vao(data);
+
+	// Ring vertices
+	if (layout == VertexLayout::Separate)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vao.position_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, vao.normals_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, vao.uv_buffer);
+	}
+	else
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vao.interleaved_buffer);
+
+	glUseProgram(ring_program);
+	glUniform1i(glGetUniformLocation(ring_program, "u_vertical_segments"), vertical_segments);
+	glUniform1i(glGetUniformLocation(ring_program, "u_rotation_segments"), rotation_segments);
+	glUniform1i(glGetUniformLocation(ring_program, "u_first_row"), plan.first_row);
+	glUniform1i(glGetUniformLocation(ring_program, "u_end_row"), plan.end_row);
+	glUniform1i(glGetUniformLocation(ring_program, "u_ring_vertex_count"), plan.ring_vertex_count);
+	glUniform1f(glGetUniformLocation(ring_program, "u_axis_tolerance"), plan.axis_tolerance);
+	glUniform3fv(glGetUniformLocation(ring_program, "u_position_scale"), 1, &vao.position_scale[0]);
+	glUniform3fv(glGetUniformLocation(ring_program, "u_position_offset"), 1, &vao.position_offset[0]);
+	glDispatchCompute(WorkGroupCount(plan.ring_vertex_count), GLuint(plan.ring_count), 1);
+
+	// Triangles
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vao.element_array_buffer);
+
+	glUseProgram(triangle_program);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_vertical_segments"), vertical_segments);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_rotation_segments"), rotation_segments);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_first_pole"), plan.first_pole ? 1 : 0);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_last_pole"), plan.last_pole ? 1 : 0);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_closed_profile"), plan.closed_profile ? 1 : 0);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_first_row"), plan.first_row);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_ring_vertex_count"), plan.ring_vertex_count);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_ring_count"), plan.ring_count);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_pole_base"), plan.pole_base);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_pole_vertex_count"), plan.pole_vertex_count);
+	glUniform1i(glGetUniformLocation(triangle_program, "u_column_triangle_count"), plan.column_triangle_count);
+	glDispatchCompute(WorkGroupCount(vertical_segments - 1), GLuint(rotation_segments - 1), 1);
+
+	// The pole vertices are written from the profile that was read back, they are the last vertices
+	auto pole_count = plan.vertex_count - plan.pole_base;
+	std::vector<glm::vec3> pole_positions(pole_count), pole_normals(pole_count);
+	std::vector<glm::vec2> pole_uvs(pole_count);
+	auto WritePole = [&](GLuint index, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+	{
+		pole_positions[index - plan.pole_base] = position;
+		pole_normals[index - plan.pole_base] = normal;
+		pole_uvs[index - plan.pole_base] = uv;
+	};
+	detail::WriteRevolutionPoles(plan, WritePole);
+
+	if (pole_count > 0 && layout == VertexLayout::Separate)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vao.position_buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, plan.pole_base * sizeof(glm::vec3), pole_count * sizeof(glm::vec3), pole_positions.data());
+		glBindBuffer(GL_ARRAY_BUFFER, vao.normals_buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, plan.pole_base * sizeof(glm::vec3), pole_count * sizeof(glm::vec3), pole_normals.data());
+		glBindBuffer(GL_ARRAY_BUFFER, vao.uv_buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, plan.pole_base * sizeof(glm::vec2), pole_count * sizeof(glm::vec2), pole_uvs.data());
+	}
+	else if (pole_count > 0)
+	{
+		std::vector<QuantizedVertex> pole_vertices(pole_count);
+		for (int i = 0; i < pole_count; ++i)
+			pole_vertices[i] = QuantizeVertex(pole_positions[i], pole_normals[i], pole_uvs[i], vao.position_scale, vao.position_offset);
+		glBindBuffer(GL_ARRAY_BUFFER, vao.interleaved_buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, plan.pole_base * sizeof(QuantizedVertex), pole_count * sizeof(QuantizedVertex), pole_vertices.data());
+	}
+
+	// Vertex fetch and index reads have to see the shader writes
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	glDeleteBuffers(1, &profile_buffer);
+
+	glUseProgram(GLuint(previous_program));
+
+	if (bounding_radius != nullptr)
+	{
+		*bounding_radius = 0;
+		for (int v = 0; v < vertical_segments; ++v)
+			*bounding_radius = glm::max(*bounding_radius, glm::length(glm::vec2(plan.profile_x[v], plan.profile_y[v])));
+	}
+
+	return vao;
+}
+
+ComputeValidationReport ValidateComputeShapeFrom2D(
+	const VAO& vao,
+	ParametricLineBatch parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	RevolutionTopology topology,
+	float tolerance
+)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	std::vector<GLuint> indices;
+	GenerateParametricShapeFrom2D(positions, normals, uvs, indices, parametric_line, vertical_segments, rotation_segments, topology);
+
+	ComputeValidationReport report = {};
+	if (positions.size() != size_t(vao.vertex_count) || indices.size() != size_t(vao.element_array_count))
+	{
+		std::cout << "Compute mesh has " << vao.vertex_count << " vertices and " << vao.element_array_count
+			<< " indices, the CPU mesh has " << positions.size() << " and " << indices.size() << "." << std::endl;
+		return report;
+	}
+
+	auto computed_indices = ReadBuffer<GLuint>(GL_ELEMENT_ARRAY_BUFFER, vao.element_array_buffer, indices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+		if (computed_indices[i] != indices[i])
+			++report.mismatched_indices;
+
+	auto within_steps = true;
+	if (vao.layout == VertexLayout::Separate)
+	{
+		auto computed_positions = ReadBuffer<glm::vec3>(GL_ARRAY_BUFFER, vao.position_buffer, positions.size());
+		auto computed_normals = ReadBuffer<glm::vec3>(GL_ARRAY_BUFFER, vao.normals_buffer, normals.size());
+		auto computed_uvs = ReadBuffer<glm::vec2>(GL_ARRAY_BUFFER, vao.uv_buffer, uvs.size());
+		for (size_t v = 0; v < positions.size(); ++v)
+		{
+			report.max_position_error = glm::max(report.max_position_error, glm::length(computed_positions[v] - positions[v]));
+			report.max_normal_error = glm::max(report.max_normal_error, glm::length(computed_normals[v] - normals[v]));
+			report.max_uv_error = glm::max(report.max_uv_error, glm::length(computed_uvs[v] - uvs[v]));
+		}
+	}
+	else
+	{
+		// The CPU mesh is quantized the same way, so both sides are compared in quantization steps
+		auto computed_vertices = ReadBuffer<QuantizedVertex>(GL_ARRAY_BUFFER, vao.interleaved_buffer, positions.size());
+		for (size_t v = 0; v < positions.size(); ++v)
+		{
+			auto vertex = QuantizeVertex(positions[v], normals[v], uvs[v], vao.position_scale, vao.position_offset);
+			auto& computed = computed_vertices[v];
+
+			glm::vec3 position_steps;
+			for (int k = 0; k < 3; ++k)
+				position_steps[k] = glm::abs(float(computed.position[k]) - float(vertex.position[k]));
+			auto uv_steps = glm::abs(glm::vec2(computed.uv[0], computed.uv[1]) - glm::vec2(vertex.uv[0], vertex.uv[1]));
+
+			// Normals on the folded edges of the octahedron have two encodings, so they are compared decoded
+			auto computed_normal = OctahedralDecode(glm::vec2(computed.normal[0], computed.normal[1]) / 32767.f);
+			auto normal = OctahedralDecode(glm::vec2(vertex.normal[0], vertex.normal[1]) / 32767.f);
+
+			within_steps = within_steps && glm::max(glm::max(position_steps.x, position_steps.y), position_steps.z) <= 1
+				&& glm::max(uv_steps.x, uv_steps.y) <= 1;
+			report.max_position_error = glm::max(report.max_position_error, glm::length(position_steps * vao.position_scale / 65535.f));
+			report.max_normal_error = glm::max(report.max_normal_error, glm::length(computed_normal - normal));
+			report.max_uv_error = glm::max(report.max_uv_error, glm::length(uv_steps / 65535.f * quantized_uv_range));
+		}
+	}
+
+	auto within_tolerance = report.max_position_error <= tolerance && report.max_normal_error <= tolerance && report.max_uv_error <= tolerance;
+	// A step of the octahedral encoding turns a normal by up to about 2 / 32767
+	within_steps = within_steps && report.max_normal_error <= tolerance + 2 / 32767.f;
+
+	report.passed = report.mismatched_indices == 0 && (vao.layout == VertexLayout::Separate ? within_tolerance : within_steps);
+	return report;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <iostream>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "opengl_utilities.h"
+#include "mesh_generation.h"
+
+/* Compute Generation Structs */
+
+// Largest differences between the compute output and GenerateParametricShapeFrom2D, in mesh
+// space for positions and uvs and as a vector difference for normals. Separate passes within
+// tolerance. Quantized layouts pass when positions and uvs are at most one quantization step
+// off and the decoded normals are within tolerance plus a step.
+struct ComputeValidationReport
+{
+	float max_position_error;
+	float max_normal_error;
+	float max_uv_error;
+	size_t mismatched_indices;
+	bool passed;
+};
+
+/* Compute Generation Functions */
+
+// Needs GL 4.3, or ARB_compute_shader with ARB_shader_storage_buffer_object and ARB_shading_language_packing
+bool ComputeGenerationSupported();
+
+// Off by default. When enabled and supported, GenerateLODChain builds the levels it does not
+// cache with ComputeParametricShapeFrom2D, and validates each of them if validate is set.
+// Compute shaders that do not build turn it off again.
+void SetComputeGeneration(bool enabled, bool validate);
+bool ComputeGenerationEnabled();
+bool ComputeValidationEnabled();
+
+// GLSL of the example batched parametric functions, each defines
+// void ParametricLine(float t, out vec2 position, out vec2 tangent)
+// nullptr for functions that have no GLSL version
+const char* ParametricLineSource(ParametricLineBatch parametric_line);
+
+// Same mesh as GenerateParametricShapeFrom2D, with the profile and every vertex and index computed
+// by compute shaders straight into the buffers of the VAO. Only the profile is read back, to find
+// the poles and the seam, and the pole vertices are written from it. Quantized positions use the
+// bounds of the profile, like StreamParametricShapeFrom2D. A function without GLSL, or shaders
+// that do not build, fall back to StreamParametricShapeFrom2D.
+VAO ComputeParametricShapeFrom2D(
+	ParametricLineBatch parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	VertexLayout layout,
+	RevolutionTopology topology = RevolutionTopology(),
+	float* bounding_radius = nullptr
+);
+
+// Reads back the buffers of vao and compares them with the CPU generator, which stays the reference
+ComputeValidationReport ValidateComputeShapeFrom2D(
+	const VAO& vao,
+	ParametricLineBatch parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	RevolutionTopology topology = RevolutionTopology(),
+	float tolerance = 1e-4f
+);
\ No newline at end of file
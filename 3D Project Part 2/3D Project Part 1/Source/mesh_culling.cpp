@@ -0,0 +1,245 @@
+#include "mesh_culling.h"
+
+#include "GLM/gtc/constants.hpp"
+
+/* Mesh Culling Constants */
+
+// Finer grids make the CPU test more patches per draw than it saves on the GPU
+static const int max_patch_bands = 16;
+
+/* Helper Functions */
+
+// Outward unit normal of the triangle, or zero when it is degenerate
+static glm::vec3 OutwardNormal(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const GLuint* triangle)
+{
+	auto& a = positions[triangle[0]];
+	auto normal = glm::cross(positions[triangle[1]] - a, positions[triangle[2]] - a);
+	auto length = glm::length(normal);
+	if (length <= 0)
+		return glm::vec3(0);
+
+	normal /= length;
+	if (glm::dot(normal, normals[triangle[0]] + normals[triangle[1]] + normals[triangle[2]]) < 0)
+		normal = -normal;
+	return normal;
+}
+
+static MeshPatch PatchBounds(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<GLuint>& indices,
+	GLuint first_index,
+	GLuint index_count
+)
+{
+	MeshPatch patch;
+	patch.first_index = first_index;
+	patch.index_count = index_count;
+
+	auto minimum = positions[indices[first_index]];
+	auto maximum = minimum;
+	auto normal_sum = glm::vec3(0);
+	for (auto i = first_index; i < first_index + index_count; ++i)
+	{
+		minimum = glm::min(minimum, positions[indices[i]]);
+		maximum = glm::max(maximum, positions[indices[i]]);
+		if ((i - first_index) % 3 == 0)
+			normal_sum += OutwardNormal(positions, normals, &indices[i]);
+	}
+
+	patch.center = (minimum + maximum) / 2.f;
+	patch.radius = 0;
+	for (auto i = first_index; i < first_index + index_count; ++i)
+		patch.radius = glm::max(patch.radius, glm::length(positions[indices[i]] - patch.center));
+
+	// Opposite normals cancel out, the patch then never faces away as a whole
+	auto normal_sum_length = glm::length(normal_sum);
+	if (normal_sum_length <= 0)
+	{
+		patch.cone_axis = glm::vec3(0, 0, 1);
+		patch.cone_angle = glm::pi<float>();
+		return patch;
+	}
+
+	patch.cone_axis = normal_sum / normal_sum_length;
+	auto min_cosine = 1.f;
+	for (auto i = first_index; i < first_index + index_count; i += 3)
+	{
+		auto normal = OutwardNormal(positions, normals, &indices[i]);
+		if (normal != glm::vec3(0))
+			min_cosine = glm::min(min_cosine, glm::dot(normal, patch.cone_axis));
+	}
+	patch.cone_angle = glm::acos(glm::clamp(min_cosine, -1.f, 1.f));
+	return patch;
+}
+
+/* Mesh Culling Functions */
+std::vector<MeshPatch> PartitionMeshPatches(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	int target_patch_triangles
+)
+{
+	auto triangle_count = indices.size() / 3;
+	std::vector<MeshPatch> patches;
+	if (triangle_count == 0)
+		return patches;
+
+	// Sectors span twice the angle of bands, so the patches around the equator are about square
+	auto bands = glm::clamp(int(glm::round(glm::sqrt(triangle_count / (2.f * target_patch_triangles)))), 1, max_patch_bands);
+	auto sectors = 2 * bands;
+	auto pi = glm::pi<float>();
+
+	std::vector<int> triangle_patches(triangle_count);
+	std::vector<GLuint> patch_offsets(bands * sectors + 1, 0);
+	for (size_t t = 0; t < triangle_count; ++t)
+	{
+		auto center = positions[indices[t * 3]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]];
+		auto length = glm::length(center);
+
+		int band = 0, sector = 0;
+		if (length > 0)
+		{
+			auto latitude = glm::asin(glm::clamp(center.y / length, -1.f, 1.f));
+			auto longitude = glm::atan(center.z, center.x);
+			band = glm::min(int((latitude / pi + 0.5f) * bands), bands - 1);
+			sector = glm::min(int((longitude / (2 * pi) + 0.5f) * sectors), sectors - 1);
+		}
+
+		triangle_patches[t] = band * sectors + sector;
+		++patch_offsets[triangle_patches[t] + 1];
+	}
+
+	for (int p = 0; p < bands * sectors; ++p)
+		patch_offsets[p + 1] += patch_offsets[p];
+
+	// Counting sort, triangles of a patch keep their order
+	std::vector<GLuint> sorted_indices(triangle_count * 3);
+	std::vector<GLuint> fill_offsets(patch_offsets.begin(), patch_offsets.end() - 1);
+	for (size_t t = 0; t < triangle_count; ++t)
+	{
+		auto destination = &sorted_indices[fill_offsets[triangle_patches[t]]++ * 3];
+		for (int k = 0; k < 3; ++k)
+			destination[k] = indices[t * 3 + k];
+	}
+	indices.swap(sorted_indices);
+
+	for (int p = 0; p < bands * sectors; ++p)
+		if (patch_offsets[p + 1] > patch_offsets[p])
+			patches.push_back(PatchBounds(positions, normals, indices, patch_offsets[p] * 3, (patch_offsets[p + 1] - patch_offsets[p]) * 3));
+
+	return patches;
+}
+
+PatchCuller CreatePatchCuller(
+	const glm::mat4& model,
+	const glm::mat4& projection_view,
+	const glm::vec3& camera_position,
+	float occluder_radius
+)
+{
+	PatchCuller culler;
+
+	// Frustum planes of the model space (Gribb and Hartmann)
+	auto clip = projection_view * model;
+	for (int axis = 0; axis < 3; ++axis)
+		for (int side = 0; side < 2; ++side)
+		{
+			auto& plane = culler.planes[axis * 2 + side];
+			for (int column = 0; column < 4; ++column)
+				plane[column] = clip[column][3] + (side == 0 ? clip[column][axis] : -clip[column][axis]);
+			plane /= glm::length(glm::vec3(plane));
+		}
+
+	// The other tests run in model space too, a uniform scale keeps the angles
+	culler.camera = glm::vec3(glm::inverse(model) * glm::vec4(camera_position, 1));
+
+	// Points beyond the plane through the horizon, and inside the cone that touches the occluder
+	// from the camera, are behind the occluder. sin(horizon_angle) = occluder_radius / camera distance.
+	auto camera_distance = glm::length(culler.camera);
+	culler.horizon_culling = occluder_radius > 0 && camera_distance > occluder_radius;
+	culler.to_center = culler.horizon_culling ? -culler.camera / camera_distance : glm::vec3(0);
+	culler.horizon_angle = culler.horizon_culling ? glm::asin(occluder_radius / camera_distance) : 0.f;
+	culler.horizon_plane_distance = culler.horizon_culling
+		? (camera_distance * camera_distance - occluder_radius * occluder_radius) / camera_distance : 0.f;
+	return culler;
+}
+
+PatchVisibility CullPatch(
+	const PatchCuller& culler,
+	const glm::vec3& center,
+	float radius,
+	const glm::vec3& cone_axis,
+	float cone_angle
+)
+{
+	for (auto& plane : culler.planes)
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return PatchVisibility::OutsideFrustum;
+
+	auto to_patch = center - culler.camera;
+	auto patch_distance = glm::length(to_patch);
+	if (patch_distance <= radius)
+		return PatchVisibility::Visible;
+
+	// Widest angle between the direction to the center and a point of the bounding sphere
+	auto bounds_angle = glm::asin(radius / patch_distance);
+	auto patch_direction = to_patch / patch_distance;
+
+	if (culler.horizon_culling
+		&& glm::dot(to_patch, culler.to_center) - radius > culler.horizon_plane_distance
+		&& glm::acos(glm::clamp(glm::dot(patch_direction, culler.to_center), -1.f, 1.f)) + bounds_angle < culler.horizon_angle)
+		return PatchVisibility::BehindHorizon;
+
+	// Every triangle faces away when every normal is less than 90 degrees from every view direction
+	if (glm::acos(glm::clamp(glm::dot(patch_direction, cone_axis), -1.f, 1.f)) + bounds_angle + cone_angle < glm::half_pi<float>())
+		return PatchVisibility::FacingAway;
+
+	return PatchVisibility::Visible;
+}
+
+PatchCullingReport CullMeshPatches(
+	const std::vector<MeshPatch>& patches,
+	const glm::mat4& model,
+	const glm::mat4& projection_view,
+	const glm::vec3& camera_position,
+	float occluder_radius,
+	std::vector<GLsizei>& counts,
+	std::vector<const void*>& offsets
+)
+{
+	PatchCullingReport report = {};
+	counts.clear();
+	offsets.clear();
+
+	auto culler = CreatePatchCuller(model, projection_view, camera_position, occluder_radius);
+
+	GLuint range_end = 0;
+	for (auto& patch : patches)
+	{
+		auto visibility = CullPatch(culler, patch.center, patch.radius, patch.cone_axis, patch.cone_angle);
+		if (visibility == PatchVisibility::OutsideFrustum)
+			++report.frustum_culled;
+		else if (visibility == PatchVisibility::BehindHorizon)
+			++report.horizon_culled;
+		else if (visibility == PatchVisibility::FacingAway)
+			++report.backface_culled;
+		if (visibility != PatchVisibility::Visible)
+			continue;
+
+		++report.visible_patches;
+		report.visible_triangles += patch.index_count / 3;
+
+		if (!counts.empty() && range_end == patch.first_index)
+			counts.back() += GLsizei(patch.index_count);
+		else
+		{
+			counts.push_back(GLsizei(patch.index_count));
+			offsets.push_back(reinterpret_cast<const void*>(size_t(patch.first_index) * sizeof(GLuint)));
+		}
+		range_end = patch.first_index + patch.index_count;
+	}
+
+	return report;
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/* Mesh Culling Structs */
+
+// A range of the index buffer that is culled as a whole
+struct MeshPatch
+{
+	GLuint first_index;
+	GLuint index_count;
+
+	// Bounding sphere of the patch's vertices, in mesh space
+	glm::vec3 center;
+	float radius;
+
+	// The outward normal of every triangle is within cone_angle of cone_axis,
+	// the angle is over pi / 2 when the normals spread too far to ever face away together
+	glm::vec3 cone_axis;
+	float cone_angle;
+};
+
+// Frustum planes and horizon of one draw in mesh space, see CreatePatchCuller
+struct PatchCuller
+{
+	// Pointing inwards
+	glm::vec4 planes[6];
+	glm::vec3 camera;
+
+	bool horizon_culling;
+	glm::vec3 to_center;
+	float horizon_angle;
+	float horizon_plane_distance;
+};
+
+enum class PatchVisibility
+{
+	Visible,
+	OutsideFrustum,
+	BehindHorizon,
+	FacingAway
+};
+
+// Patches skipped by each test, a patch only counts for the first test that removes it
+struct PatchCullingReport
+{
+	size_t visible_patches;
+	size_t frustum_culled;
+	size_t horizon_culled;
+	size_t backface_culled;
+	size_t visible_triangles;
+};
+
+/* Mesh Culling Functions */
+
+// Sorts the triangles into patches of latitude bands and longitude sectors around the mesh space
+// origin, by the direction of their centers. The sort is stable, so the vertex cache order of
+// OptimizeVertexCache is kept within each patch. Outward is the side the vertex normals point to.
+// Grids are sized for about target_patch_triangles per patch, empty patches are left out.
+std::vector<MeshPatch> PartitionMeshPatches(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	int target_patch_triangles = 256
+);
+
+// Sets up the tests of CullPatch for a draw with this model transform. An occluder_radius of 0
+// turns off horizon culling, the transform may rotate and translate but only scale uniformly.
+PatchCuller CreatePatchCuller(
+	const glm::mat4& model,
+	const glm::mat4& projection_view,
+	const glm::vec3& camera_position,
+	float occluder_radius
+);
+
+// Bounds are in mesh space, as in MeshPatch. The frustum is tested first, then the horizon of
+// the occluder sphere, then whether every triangle faces away from the camera.
+PatchVisibility CullPatch(
+	const PatchCuller& culler,
+	const glm::vec3& center,
+	float radius,
+	const glm::vec3& cone_axis,
+	float cone_angle
+);
+
+// Fills counts and offsets with the index ranges of the patches that are inside the frustum,
+// in front of the horizon of the sphere of occluder_radius around the mesh space origin,
+// and not facing away from the camera, ready for glMultiDrawElements. Ranges of visible
+// patches that follow each other are merged. See CreatePatchCuller for occluder_radius and model.
+PatchCullingReport CullMeshPatches(
+	const std::vector<MeshPatch>& patches,
+	const glm::mat4& model,
+	const glm::mat4& projection_view,
+	const glm::vec3& camera_position,
+	float occluder_radius,
+	std::vector<GLsizei>& counts,
+	std::vector<const void*>& offsets
+);
\ No newline at end of file
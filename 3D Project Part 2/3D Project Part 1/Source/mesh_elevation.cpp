@@ -0,0 +1,480 @@
+#include "mesh_elevation.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include "GLM/gtc/constants.hpp"
+
+#include "mesh_terrain.h"
+
+/* Elevation Constants */
+
+// Pages are wanted closer than this many page edge lengths to a focus point. A page has about twice
+// the samples of a terrain node along its edge, and the terrain splits nodes at 4 to 16 edges.
+static const float page_range = 2;
+
+// Uploads per frame, the worker makes pages slower than this anyway
+static const int max_page_uploads = 16;
+
+// Fractal noise, frequencies are per unit of the direction
+static const int noise_octaves = 10;
+static const float noise_frequency = 1.5f;
+
+// Craters are placed in cells of each octave, the first octave has crater_frequency cells per unit
+static const int crater_octaves = 6;
+static const float crater_frequency = 3;
+static const float crater_density = 0.5f;
+
+// Crater radius in cells, the rim reaches 1.5 radii, so a crater stays within half a cell of its center
+static const float min_crater_radius = 0.1f;
+static const float max_crater_radius = 0.33f;
+
+// Depth of a crater per unit of its radius in direction units
+static const float crater_depth = 6;
+
+/* Helper Functions */
+
+static std::uint64_t PageId(const ElevationPageKey& key)
+{
+	return (std::uint64_t(key.face * 16 + key.level) << 32) | (std::uint64_t(key.x) << 16) | std::uint64_t(key.y);
+}
+
+static ElevationPageKey ParentKey(const ElevationPageKey& key)
+{
+	return { key.face, key.level - 1, key.x / 2, key.y / 2 };
+}
+
+static ElevationPageKey ChildKey(const ElevationPageKey& key, int child)
+{
+	return { key.face, key.level + 1, key.x * 2 + child % 2, key.y * 2 + child / 2 };
+}
+
+// Bounding sphere of the spherical cap of the page, as in SelectNode of mesh_terrain.cpp
+static glm::vec4 PageBounds(const ElevationPageKey& key)
+{
+	auto size = 2.f / float(1 << key.level);
+	auto corner = glm::vec2(-1) + glm::vec2(key.x, key.y) * size;
+	auto center = TerrainFacePoint(key.face, corner + size / 2);
+	float angle = 0;
+	for (int k = 0; k < 4; ++k)
+		angle = glm::max(angle, glm::acos(glm::clamp(glm::dot(center, TerrainFacePoint(key.face, corner + size * glm::vec2(k % 2, k / 2))), -1.f, 1.f)));
+	return glm::vec4(center * glm::cos(angle), glm::sin(angle));
+}
+
+static std::uint32_t HashCell(const glm::ivec3& cell, std::uint32_t seed)
+{
+	auto hash = std::uint32_t(cell.x) * 0x8da6b343u ^ std::uint32_t(cell.y) * 0xd8163841u
+		^ std::uint32_t(cell.z) * 0xcb1ab31fu ^ seed * 0x9e3779b9u;
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68bu;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+// Uniform in [0, 1)
+static float HashUnit(std::uint32_t hash)
+{
+	return (hash >> 8) * (1.f / 16777216.f);
+}
+
+// Improved Perlin noise, about [-1, 1]
+static float GradientNoise(const glm::vec3& point, std::uint32_t seed)
+{
+	static const glm::vec3 gradients[12] = {
+		glm::vec3(1, 1, 0), glm::vec3(-1, 1, 0), glm::vec3(1, -1, 0), glm::vec3(-1, -1, 0),
+		glm::vec3(1, 0, 1), glm::vec3(-1, 0, 1), glm::vec3(1, 0, -1), glm::vec3(-1, 0, -1),
+		glm::vec3(0, 1, 1), glm::vec3(0, -1, 1), glm::vec3(0, 1, -1), glm::vec3(0, -1, -1)
+	};
+
+	auto floor = glm::floor(point);
+	auto cell = glm::ivec3(floor);
+	auto f = point - floor;
+	auto fade = f * f * f * (f * (f * 6.f - 15.f) + 10.f);
+
+	float values[8];
+	for (int k = 0; k < 8; ++k)
+	{
+		auto offset = glm::ivec3(k & 1, (k >> 1) & 1, k >> 2);
+		values[k] = glm::dot(gradients[HashCell(cell + offset, seed) % 12], f - glm::vec3(offset));
+	}
+
+	for (int k = 0; k < 4; ++k)
+		values[k] = glm::mix(values[k * 2], values[k * 2 + 1], fade.x);
+	for (int k = 0; k < 2; ++k)
+		values[k] = glm::mix(values[k * 2], values[k * 2 + 1], fade.y);
+	return glm::mix(values[0], values[1], fade.z);
+}
+
+// Bowl shaped craters with a raised rim. Their centers are random points of the cells of the frequency,
+// a crater shows where the sphere passes through its ball. Only the eight cells around the point can
+// reach it, see max_crater_radius.
+static float CraterField(const glm::vec3& direction, float frequency, std::uint32_t seed)
+{
+	auto point = direction * frequency;
+	auto first = glm::ivec3(glm::floor(point - 0.5f));
+
+	float height = 0;
+	for (int k = 0; k < 8; ++k)
+	{
+		auto cell = first + glm::ivec3(k & 1, (k >> 1) & 1, k >> 2);
+		if (HashUnit(HashCell(cell, seed)) > crater_density)
+			continue;
+
+		auto center = glm::vec3(cell) + glm::vec3(
+			HashUnit(HashCell(cell, seed + 1)), HashUnit(HashCell(cell, seed + 2)), HashUnit(HashCell(cell, seed + 3)));
+		auto size = HashUnit(HashCell(cell, seed + 4));
+		auto radius = glm::mix(min_crater_radius, max_crater_radius, size * size);
+
+		auto t = glm::length(point - center) / radius;
+		if (t >= 1.5f)
+			continue;
+
+		auto bowl = glm::min(t * t - 1, 0.f);
+		auto rim_distance = 1 - (t - 1) * (t - 1) / 0.25f;
+		auto rim = 0.4f * glm::max(rim_distance, 0.f) * glm::max(rim_distance, 0.f);
+		height += (bowl + rim) * crater_depth * radius / frequency;
+	}
+	return height;
+}
+
+static std::vector<float> GenerateElevationPage(const ElevationPageKey& key, int page_samples)
+{
+	auto size = 2.f / float(1 << key.level);
+	auto corner = glm::vec2(-1) + glm::vec2(key.x, key.y) * size;
+	auto step = size / float(page_samples - 1);
+
+	// The equal angle projection keeps samples about quarter_pi * step apart on the sphere
+	auto spacing = glm::quarter_pi<float>() * step;
+
+	std::vector<float> heights(size_t(page_samples) * page_samples);
+	for (int j = 0; j < page_samples; ++j)
+		for (int i = 0; i < page_samples; ++i)
+			heights[size_t(j) * page_samples + i] = SampleElevation(TerrainFacePoint(key.face, corner + step * glm::vec2(i, j)), spacing);
+	return heights;
+}
+
+static void RunElevationWorker(ElevationWorker* worker)
+{
+	std::unique_lock<std::mutex> lock(worker->mutex);
+	while (true)
+	{
+		worker->wake.wait(lock, [&] { return worker->stop || !worker->requests.empty(); });
+		if (worker->stop)
+			return;
+
+		ElevationPageData page;
+		page.key = worker->requests.front();
+		worker->requests.pop_front();
+		worker->working = true;
+		worker->working_key = page.key;
+
+		lock.unlock();
+		page.heights = GenerateElevationPage(page.key, worker->page_samples);
+		lock.lock();
+
+		worker->working = false;
+		worker->finished.push_back(std::move(page));
+	}
+}
+
+// Points the part of the page table covered by the page at the layer and level
+static void WritePageTable(const TerrainElevation& elevation, const ElevationPageKey& key, int layer, int level)
+{
+	auto texels = 1 << (elevation.max_level - key.level);
+	std::vector<GLushort> entries(size_t(texels) * texels * 2);
+	for (size_t i = 0; i < entries.size(); i += 2)
+	{
+		entries[i] = GLushort(layer);
+		entries[i + 1] = GLushort(level);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + elevation.texture_unit + 1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, elevation.page_table_texture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, key.x * texels, key.y * texels, key.face, texels, texels, 1,
+		GL_RG_INTEGER, GL_UNSIGNED_SHORT, entries.data());
+}
+
+static void UploadPage(TerrainElevation& elevation, int layer, const ElevationPageData& page)
+{
+	glActiveTexture(GL_TEXTURE0 + elevation.texture_unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, elevation.page_texture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, elevation.page_samples, elevation.page_samples, 1,
+		GL_RED, GL_FLOAT, page.heights.data());
+
+	auto& resident = elevation.pages[layer];
+	resident.key = page.key;
+	resident.resident_children = 0;
+	resident.last_used_frame = elevation.frame;
+	for (int k = 0; k < 4; ++k)
+		resident.child_bounds[k] = PageBounds(ChildKey(page.key, k));
+	elevation.page_layers[PageId(page.key)] = layer;
+
+	if (page.key.level > 0)
+		++elevation.pages[elevation.page_layers[PageId(ParentKey(page.key))]].resident_children;
+	WritePageTable(elevation, page.key, layer, page.key.level);
+}
+
+// The page table falls back to the parent, which is resident as long as the page is
+static void EvictPage(TerrainElevation& elevation, int layer)
+{
+	auto& page = elevation.pages[layer];
+	auto parent_layer = elevation.page_layers[PageId(ParentKey(page.key))];
+	--elevation.pages[parent_layer].resident_children;
+	WritePageTable(elevation, page.key, parent_layer, page.key.level - 1);
+
+	elevation.page_layers.erase(PageId(page.key));
+	page.key.level = -1;
+	elevation.free_layers.push_back(layer);
+}
+
+// Least recently used page without resident children that was not used this frame, or -1
+static int EvictionCandidate(const TerrainElevation& elevation, int keep_layer)
+{
+	int candidate = -1;
+	for (int layer = 0; layer < int(elevation.pages.size()); ++layer)
+	{
+		auto& page = elevation.pages[layer];
+		if (page.key.level <= 0 || page.resident_children > 0 || page.last_used_frame >= elevation.frame || layer == keep_layer)
+			continue;
+		if (candidate < 0 || page.last_used_frame < elevation.pages[candidate].last_used_frame)
+			candidate = layer;
+	}
+	return candidate;
+}
+
+struct PageRequest
+{
+	ElevationPageKey key;
+	float distance;
+};
+
+// Marks the resident pages around the focus points as used and collects the missing ones
+static void VisitPage(
+	TerrainElevation& elevation,
+	int layer,
+	const std::vector<glm::vec3>& focus_points,
+	std::vector<PageRequest>& requests,
+	ElevationStreamingReport& report
+)
+{
+	auto& page = elevation.pages[layer];
+	page.last_used_frame = elevation.frame;
+	report.deepest_level = glm::max(report.deepest_level, page.key.level);
+	if (page.key.level == elevation.max_level)
+		return;
+
+	auto child_edge = glm::half_pi<float>() / float(1 << (page.key.level + 1));
+	for (int k = 0; k < 4; ++k)
+	{
+		auto& bounds = page.child_bounds[k];
+		auto distance = std::numeric_limits<float>::max();
+		for (auto& focus : focus_points)
+			distance = glm::min(distance, glm::max(glm::length(focus - glm::vec3(bounds)) - bounds.w, 0.f));
+		if (distance >= page_range * child_edge)
+			continue;
+
+		auto child = ChildKey(page.key, k);
+		auto resident = elevation.page_layers.find(PageId(child));
+		if (resident != elevation.page_layers.end())
+			VisitPage(elevation, resident->second, focus_points, requests, report);
+		else
+			requests.push_back({ child, distance });
+	}
+}
+
+/* Elevation Functions */
+float SampleElevation(const glm::vec3& direction, float sample_spacing)
+{
+	// Waves shorter than two samples alias
+	auto max_frequency = sample_spacing > 0 ? 0.5f / sample_spacing : std::numeric_limits<float>::max();
+
+	float height = 0;
+	auto amplitude = 0.5f;
+	auto frequency = noise_frequency;
+	for (int octave = 0; octave < noise_octaves && frequency <= max_frequency; ++octave)
+	{
+		height += amplitude * GradientNoise(direction * frequency, std::uint32_t(octave));
+		amplitude *= 0.5f;
+		frequency *= 2;
+	}
+
+	frequency = crater_frequency;
+	for (int octave = 0; octave < crater_octaves && frequency <= max_frequency * min_crater_radius; ++octave)
+	{
+		height += CraterField(direction, frequency, std::uint32_t(noise_octaves + octave * 8));
+		frequency *= 2;
+	}
+	return height;
+}
+
+TerrainElevation CreateTerrainElevation(
+	int texture_unit,
+	size_t memory_budget,
+	int max_level,
+	int page_samples,
+	float height_scale
+)
+{
+	TerrainElevation elevation;
+	elevation.texture_unit = texture_unit;
+	elevation.page_samples = page_samples;
+	elevation.max_level = glm::clamp(max_level, 1, 10);
+	elevation.height_scale = height_scale;
+	elevation.frame = 0;
+
+	GLint max_layers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+	auto page_bytes = size_t(page_samples) * page_samples * sizeof(float);
+	elevation.page_capacity = glm::clamp(int(memory_budget / page_bytes), 6, glm::max(int(max_layers), 6));
+
+	elevation.pages.resize(elevation.page_capacity);
+	for (int layer = elevation.page_capacity - 1; layer >= 0; --layer)
+	{
+		elevation.pages[layer].key.level = -1;
+		elevation.free_layers.push_back(layer);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + texture_unit);
+	glGenTextures(1, &elevation.page_texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, elevation.page_texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, page_samples, page_samples, elevation.page_capacity, 0, GL_RED, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	auto table_size = 1 << elevation.max_level;
+	glActiveTexture(GL_TEXTURE0 + texture_unit + 1);
+	glGenTextures(1, &elevation.page_table_texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, elevation.page_table_texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RG16UI, table_size, table_size, 6, 0, GL_RG_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// The faces are the fallback for everything else
+	for (int face = 0; face < 6; ++face)
+	{
+		ElevationPageData page;
+		page.key = { face, 0, 0, 0 };
+		page.heights = GenerateElevationPage(page.key, page_samples);
+		auto layer = elevation.free_layers.back();
+		elevation.free_layers.pop_back();
+		UploadPage(elevation, layer, page);
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	elevation.worker.reset(new ElevationWorker());
+	auto& worker = *elevation.worker;
+	worker.stop = false;
+	worker.working = false;
+	worker.page_samples = page_samples;
+	worker.thread = std::thread(RunElevationWorker, &worker);
+	return elevation;
+}
+
+ElevationStreamingReport UpdateTerrainElevation(TerrainElevation& elevation, const std::vector<glm::vec3>& focus_points)
+{
+	ElevationStreamingReport report = {};
+	++elevation.frame;
+
+	std::vector<PageRequest> requests;
+	for (int face = 0; face < 6; ++face)
+		VisitPage(elevation, elevation.page_layers[PageId({ face, 0, 0, 0 })], focus_points, requests, report);
+
+	auto& worker = *elevation.worker;
+	std::vector<ElevationPageData> finished;
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		auto count = std::min(worker.finished.size(), size_t(max_page_uploads));
+		std::move(worker.finished.begin(), worker.finished.begin() + count, std::back_inserter(finished));
+		worker.finished.erase(worker.finished.begin(), worker.finished.begin() + count);
+	}
+
+	// Pages whose parent was evicted while they were made are dropped, they are asked for again when wanted
+	for (auto& page : finished)
+	{
+		auto parent = elevation.page_layers.find(PageId(ParentKey(page.key)));
+		if (parent == elevation.page_layers.end() || elevation.page_layers.count(PageId(page.key)) > 0)
+			continue;
+
+		int layer = -1;
+		if (!elevation.free_layers.empty())
+		{
+			layer = elevation.free_layers.back();
+			elevation.free_layers.pop_back();
+		}
+		else
+		{
+			// Every page was used this frame when there is no candidate, the budget is full
+			auto candidate = EvictionCandidate(elevation, parent->second);
+			if (candidate < 0)
+				continue;
+			EvictPage(elevation, candidate);
+			++report.evicted_pages;
+			layer = elevation.free_layers.back();
+			elevation.free_layers.pop_back();
+		}
+
+		UploadPage(elevation, layer, page);
+		++report.uploaded_pages;
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	// Coarse pages first, the finer ones can not be shown without them. No more pages are asked for
+	// than can be made room for, the budget would otherwise keep the worker busy with pages it drops.
+	requests.erase(std::remove_if(requests.begin(), requests.end(), [&](const PageRequest& request)
+	{
+		return elevation.page_layers.count(PageId(request.key)) > 0;
+	}), requests.end());
+	std::sort(requests.begin(), requests.end(), [](const PageRequest& a, const PageRequest& b)
+	{
+		return a.key.level != b.key.level ? a.key.level < b.key.level : a.distance < b.distance;
+	});
+	report.missing_pages = int(requests.size());
+
+	auto room = elevation.free_layers.size();
+	for (auto& page : elevation.pages)
+		if (page.key.level > 0 && page.resident_children == 0 && page.last_used_frame < elevation.frame)
+			++room;
+	if (requests.size() > room)
+		requests.resize(room);
+
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.requests.clear();
+		for (auto& request : requests)
+		{
+			auto id = PageId(request.key);
+			auto finished_page = std::find_if(worker.finished.begin(), worker.finished.end(), [&](const ElevationPageData& page)
+			{
+				return PageId(page.key) == id;
+			});
+			if ((!worker.working || PageId(worker.working_key) != id) && finished_page == worker.finished.end())
+				worker.requests.push_back(request.key);
+		}
+	}
+	worker.wake.notify_one();
+
+	report.resident_pages = int(elevation.page_layers.size());
+	report.page_capacity = elevation.page_capacity;
+	return report;
+}
+
+void DestroyTerrainElevation(TerrainElevation& elevation)
+{
+	if (elevation.worker)
+	{
+		{
+			std::lock_guard<std::mutex> lock(elevation.worker->mutex);
+			elevation.worker->stop = true;
+		}
+		elevation.worker->wake.notify_one();
+		elevation.worker->thread.join();
+		elevation.worker.reset();
+	}
+
+	glDeleteTextures(1, &elevation.page_texture);
+	glDeleteTextures(1, &elevation.page_table_texture);
+}
\ No newline at end of file
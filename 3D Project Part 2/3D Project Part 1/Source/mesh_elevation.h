@@ -0,0 +1,128 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/* Elevation Structs */
+
+// The page of level L at (x, y) covers [-1 + x * s, -1 + (x + 1) * s] by [-1 + y * s, -1 + (y + 1) * s]
+// of its cube face in face coordinates, with s = 2 / 2^L, the same as a terrain node of depth L
+struct ElevationPageKey
+{
+	int face;
+	int level;
+	int x;
+	int y;
+};
+
+// Heights of a page made by the worker, page_samples rows of page_samples, the first and last
+// rows and columns lie on the edges of the page
+struct ElevationPageData
+{
+	ElevationPageKey key;
+	std::vector<float> heights;
+};
+
+// State shared by the render thread and the worker thread, everything but thread is guarded by mutex
+struct ElevationWorker
+{
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stop;
+	int page_samples;
+
+	// Most wanted first, replaced every frame by UpdateTerrainElevation
+	std::deque<ElevationPageKey> requests;
+
+	// The page the worker is making, and the pages waiting to be uploaded
+	bool working;
+	ElevationPageKey working_key;
+	std::vector<ElevationPageData> finished;
+};
+
+// A layer of the page texture, key.level is negative while the layer is free
+struct ElevationPage
+{
+	ElevationPageKey key;
+	int resident_children;
+	int last_used_frame;
+
+	// Bounding spheres of the four children on the unit sphere, center and radius
+	glm::vec4 child_bounds[4];
+};
+
+// Heights of the unit sphere in pages over the cube faces of the terrain, loaded around the points of
+// interest on a worker thread and kept within a fixed number of layers with least recently used
+// eviction. Pages are nested, a page is only resident while its parent is, so the page table can
+// point every part of the finest level to the finest resident page that covers it.
+//
+// The pages are a GL_TEXTURE_2D_ARRAY of R32F on texture unit texture_unit, the page table is a
+// GL_TEXTURE_2D_ARRAY of RG16UI on the unit after it, with a layer of 2^max_level by 2^max_level
+// texels per face holding the page texture layer and page level. The six pages of level 0 are
+// made up front and never evicted.
+struct TerrainElevation
+{
+	GLuint page_texture;
+	GLuint page_table_texture;
+	int texture_unit;
+
+	int page_samples;
+	int max_level;
+	int page_capacity;
+
+	// Mesh space displacement of a height of 1, heights are within about [-1, 1]
+	float height_scale;
+
+	std::vector<ElevationPage> pages;
+	std::vector<int> free_layers;
+	std::unordered_map<std::uint64_t, int> page_layers;
+	int frame;
+
+	std::unique_ptr<ElevationWorker> worker;
+};
+
+struct ElevationStreamingReport
+{
+	int resident_pages;
+	int page_capacity;
+	int deepest_level;
+
+	// Pages wanted around the points of interest that are not resident yet
+	int missing_pages;
+
+	int uploaded_pages;
+	int evicted_pages;
+};
+
+/* Elevation Functions */
+
+// Procedural Mars-like height of the unit sphere direction, fractal noise with craters. Features
+// smaller than about two sample_spacing are left out, so coarse pages do not alias.
+float SampleElevation(const glm::vec3& direction, float sample_spacing = 0);
+
+// page_capacity is memory_budget over the size of a page, clamped to GL_MAX_ARRAY_TEXTURE_LAYERS.
+// max_level is clamped to [1, 10], its page table takes 24 MB at 10.
+TerrainElevation CreateTerrainElevation(
+	int texture_unit,
+	size_t memory_budget = 8 << 20,
+	int max_level = 7,
+	int page_samples = 65,
+	float height_scale = 0.015f
+);
+
+// Uploads the pages the worker finished, then asks it for the missing pages around the
+// focus points, which are in the mesh space of the unit sphere. Call once per frame.
+ElevationStreamingReport UpdateTerrainElevation(TerrainElevation& elevation, const std::vector<glm::vec3>& focus_points);
+
+// Stops the worker and deletes the textures
+void DestroyTerrainElevation(TerrainElevation& elevation);
\ No newline at end of file
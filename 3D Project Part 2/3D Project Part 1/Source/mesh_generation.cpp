@@ -1,5 +1,7 @@
 #include "mesh_generation.h"
 
+#include <unordered_map>
+
 /* Generator Functions */
 void GenerateParametricShapeFrom2D(
 	std::vector<glm::vec3>& positions,
@@ -8,116 +10,527 @@ void GenerateParametricShapeFrom2D(
 	std::vector<GLuint>& indices,
 	glm::dvec2(*parametric_line)(double),
 	int vertical_segments,
+	int rotation_segments,
+	RevolutionTopology topology
+)
+{
+	GenerateParametricShapeFrom2D<glm::dvec2(*)(double)>(
+		positions, normals, uvs, indices, parametric_line, vertical_segments, rotation_segments, topology);
+}
+
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLineSample(*parametric_line)(double),
+	int vertical_segments,
+	int rotation_segments,
+	RevolutionTopology topology
+)
+{
+	GenerateParametricShapeFrom2D<ParametricLineSample(*)(double)>(
+		positions, normals, uvs, indices, parametric_line, vertical_segments, rotation_segments, topology);
+}
+
+void GenerateParametricShapeFrom3D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	glm::dvec3(*parametric_surface)(double, double),
+	int vertical_segments,
+	int rotation_segments
+)
+{
+	GenerateParametricShapeFrom3D<glm::dvec3(*)(double, double)>(
+		positions, normals, indices, parametric_surface, vertical_segments, rotation_segments);
+}
+
+void GenerateParametricShapeFrom3D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	ParametricSurfaceSample(*parametric_surface)(double, double),
+	int vertical_segments,
 	int rotation_segments
 )
 {
-	auto parametric_surface = [parametric_line](double t, double r)
+	GenerateParametricShapeFrom3D<ParametricSurfaceSample(*)(double, double)>(
+		positions, normals, indices, parametric_surface, vertical_segments, rotation_segments);
+}
+
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLineBatch parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	RevolutionTopology topology
+)
+{
+	auto profile = detail::SampleParametricProfile(parametric_line, vertical_segments);
+	GenerateParametricShapeFromProfile(positions, normals, uvs, indices, profile, rotation_segments, topology);
+}
+
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLineBatch parametric_line,
+	AdaptiveSampling sampling,
+	RevolutionTopology topology
+)
+{
+	int rotation_segments;
+	auto profile_t = AdaptiveRevolutionParameters(parametric_line, sampling, rotation_segments);
+
+	int vertical_segments = int(profile_t.size());
+	std::vector<double> x(vertical_segments), y(vertical_segments);
+	std::vector<double> tangent_x(vertical_segments), tangent_y(vertical_segments);
+	parametric_line(profile_t.data(), vertical_segments, x.data(), y.data(), tangent_x.data(), tangent_y.data());
+
+	std::vector<ParametricLineSample> profile(vertical_segments);
+	for (int v = 0; v < vertical_segments; ++v)
+	{
+		profile[v].position = glm::dvec2(x[v], y[v]);
+		profile[v].tangent = glm::dvec2(tangent_x[v], tangent_y[v]);
+	}
+
+	GenerateParametricShapeFromProfile(positions, normals, uvs, indices, profile, profile_t, rotation_segments, topology);
+}
+
+std::vector<double> AdaptiveRevolutionParameters(ParametricLineBatch parametric_line, AdaptiveSampling sampling, int& rotation_segments)
+{
+	// The batch also writes tangents, they are not needed to place the samples
+	std::vector<double> scratch_x, scratch_y;
+	auto profile_t = detail::AdaptiveProfileParameters([&](const double* t, int count, double* x, double* y)
+	{
+		scratch_x.resize(count);
+		scratch_y.resize(count);
+		parametric_line(t, count, x, y, scratch_x.data(), scratch_y.data());
+	}, sampling);
+
+	auto count = int(profile_t.size());
+	std::vector<double> x(count), y(count);
+	scratch_x.resize(count);
+	scratch_y.resize(count);
+	parametric_line(profile_t.data(), count, x.data(), y.data(), scratch_x.data(), scratch_y.data());
+
+	double max_radius = 0;
+	for (auto& radius : x)
+		max_radius = glm::max(max_radius, glm::abs(radius));
+
+	rotation_segments = detail::RotationSegmentsForError(max_radius, sampling.max_error / 2);
+	return profile_t;
+}
+
+void GenerateParametricShapeFromProfile(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	const std::vector<ParametricLineSample>& profile,
+	int rotation_segments,
+	RevolutionTopology topology
+)
+{
+	std::vector<double> profile_t(profile.size());
+	for (size_t v = 0; v < profile.size(); ++v)
+		profile_t[v] = v / double(profile.size() - 1);
+
+	GenerateParametricShapeFromProfile(positions, normals, uvs, indices, profile, profile_t, rotation_segments, topology);
+}
+
+// The profile only depends on v and the rotation only depends on r, so each of
+// them is evaluated once and combined per vertex.
+void GenerateParametricShapeFromProfile(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	const std::vector<ParametricLineSample>& profile,
+	const std::vector<double>& profile_t,
+	int rotation_segments,
+	RevolutionTopology topology
+)
+{
+	auto layout = detail::PlanRevolution(profile, profile_t, rotation_segments, topology);
+
+	positions.resize(layout.vertex_count);
+	normals.resize(layout.vertex_count);
+	uvs.resize(layout.vertex_count);
+	indices.resize(layout.index_count);
+
+	auto WriteVertex = [&](GLuint index, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
 	{
-		auto p = glm::dvec3(parametric_line(t), 0);
-		return glm::rotateY(p, r * glm::two_pi<double>());
+		positions[index] = position;
+		normals[index] = normal;
+		uvs[index] = uv;
 	};
 
-	positions.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
-			positions.push_back(
-				parametric_surface(v / double(vertical_segments - 1), r / double(rotation_segments - 1)));
+	detail::WriteRevolutionPoles(layout, WriteVertex);
 
-	normals.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
+	detail::ParallelFor(rotation_segments, [&](int begin, int end)
+	{
+		auto write_vertex = WriteVertex;
+		for (int r = begin; r < end; ++r)
 		{
-			auto nv = v / double(vertical_segments - 1);
-			auto nr = r / double(rotation_segments);
-			auto epsilonv = 1 / double(vertical_segments - 1);
-			auto epsilonr = 1 / double(rotation_segments);
+			// With a welded seam the last ring is the first one, so it has no vertices of its own
+			if (r < layout.ring_count)
+				detail::WriteRevolutionRing(layout, r, write_vertex);
 
-			auto to_next_v = parametric_surface(nv + epsilonv, nr) - parametric_surface(nv, nr);
-			auto from_prev_v = parametric_surface(nv, nr) - parametric_surface(nv - epsilonv, nr);
-			auto tangent_v = (to_next_v + from_prev_v) / 2.;
+			// The last ring closes the surface, so it does not start any quads
+			if (r < rotation_segments - 1)
+				detail::WriteRevolutionTriangles(layout, r, 0, layout.vertical_segments - 1, &indices[size_t(r) * layout.column_triangle_count * 3]);
+		}
+	});
+}
 
-			auto to_next_r = parametric_surface(nv, nr + epsilonr) - parametric_surface(nv, nr);
-			auto from_prev_r = parametric_surface(nv, nr) - parametric_surface(nv, nr - epsilonr);
-			auto tangent_r = (to_next_r + from_prev_r) / 2.;
+detail::RevolutionLayout detail::PlanRevolution(
+	const std::vector<ParametricLineSample>& profile,
+	const std::vector<double>& profile_t,
+	int rotation_segments,
+	RevolutionTopology topology
+)
+{
+	RevolutionLayout layout;
+	int vertical_segments = int(profile.size());
+	layout.vertical_segments = vertical_segments;
+	layout.rotation_segments = rotation_segments;
 
-			auto normal = glm::normalize(glm::cross(tangent_r, tangent_v));
-			normals.push_back(normal);
-		}
+	// Structure of arrays, so the per vertex loop only does multiplications on contiguous data
+	layout.profile_x.resize(vertical_segments);
+	layout.profile_y.resize(vertical_segments);
+	layout.profile_normal_x.resize(vertical_segments);
+	layout.profile_normal_y.resize(vertical_segments);
+	layout.profile_v.resize(vertical_segments);
+
+	double max_radius = 0;
+	for (int v = 0; v < vertical_segments; ++v)
+		max_radius = glm::max(max_radius, glm::abs(profile[v].position.x));
+
+	// Samples this close to the axis or to each other are the same vertex, e.g. cos(PI/2) is not exactly 0
+	auto tolerance = 1e-6 * max_radius;
+	layout.axis_tolerance = float(tolerance);
 
-	uvs.reserve(vertical_segments * rotation_segments);
+	double min_y = profile[0].position.y, max_y = profile[0].position.y;
+	for (int v = 0; v < vertical_segments; ++v)
+	{
+		// Matches the orientation of cross(tangent_r, tangent_v) on the surface. Samples on the
+		// axis keep it, rounding can leave them on either side.
+		auto normal = glm::dvec2(profile[v].tangent.y, -profile[v].tangent.x);
+		if (profile[v].position.x < -tolerance)
+			normal = -normal;
+		normal = glm::normalize(normal);
+
+		layout.profile_x[v] = float(profile[v].position.x);
+		layout.profile_y[v] = float(profile[v].position.y);
+		layout.profile_normal_x[v] = float(normal.x);
+		layout.profile_normal_y[v] = float(normal.y);
+		layout.profile_v[v] = float(profile_t[v]);
+		min_y = glm::min(min_y, profile[v].position.y);
+		max_y = glm::max(max_y, profile[v].position.y);
+	}
+	layout.max_radius = float(max_radius);
+	layout.min_y = float(min_y);
+	layout.max_y = float(max_y);
+
+	layout.first_pole = topology.collapse_poles && glm::abs(profile.front().position.x) <= tolerance;
+	layout.last_pole = topology.collapse_poles && glm::abs(profile.back().position.x) <= tolerance;
+	layout.closed_profile = topology.weld_seam && !layout.first_pole && !layout.last_pole
+		&& glm::length(profile.front().position - profile.back().position) <= tolerance;
+
+	layout.first_row = layout.first_pole ? 1 : 0;
+	layout.end_row = layout.last_pole || layout.closed_profile ? vertical_segments - 1 : vertical_segments;
+	layout.ring_vertex_count = layout.end_row - layout.first_row;
+	layout.ring_count = topology.weld_seam ? rotation_segments - 1 : rotation_segments;
+	layout.pole_base = layout.ring_count * layout.ring_vertex_count;
+	layout.column_triangle_count = 2 * (vertical_segments - 1) - (layout.first_pole ? 1 : 0) - (layout.last_pole ? 1 : 0);
+	layout.pole_vertex_count = topology.weld_seam ? 1 : rotation_segments - 1;
+
+	layout.vertex_count = layout.pole_base + ((layout.first_pole ? 1 : 0) + (layout.last_pole ? 1 : 0)) * layout.pole_vertex_count;
+	layout.index_count = size_t(rotation_segments - 1) * layout.column_triangle_count * 3;
+
+	std::vector<double> angles(rotation_segments), sines(rotation_segments), cosines(rotation_segments);
 	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
-			uvs.push_back(glm::vec2(r / double(rotation_segments - 1), v / double(vertical_segments - 1)));
+		angles[r] = r / double(rotation_segments - 1) * glm::two_pi<double>();
+	SinCosBatch(angles.data(), rotation_segments, sines.data(), cosines.data());
 
-	auto VRtoIndex = [vertical_segments, rotation_segments](int v, int r)
+	layout.sines.assign(sines.begin(), sines.end());
+	layout.cosines.assign(cosines.begin(), cosines.end());
+	return layout;
+}
+
+/* Sphere Generator Functions */
+
+// Adds the triangle wound the same way as the surfaces of revolution, cross(b - a, c - a) points inwards
+static void AddSphereTriangle(std::vector<GLuint>& indices, const std::vector<glm::vec3>& positions, GLuint a, GLuint b, GLuint c)
+{
+	auto normal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+	if (glm::dot(normal, positions[a] + positions[b] + positions[c]) > 0)
+		std::swap(b, c);
+
+	indices.push_back(a);
+	indices.push_back(b);
+	indices.push_back(c);
+}
+
+// Inverse of the surface of revolution of ParametricHalfCircle, u follows the rotation and v goes up
+static glm::vec2 EquirectangularUV(const glm::vec3& position)
+{
+	// Points on the seam get u = 0 even when rounding puts them just below it,
+	// the triangles on the other side of the seam use copies at u = 1
+	auto u = atan2(-position.z, position.x) / glm::two_pi<float>();
+	if (u < 0)
+		u += 1;
+	if (u > 1 - 1e-6f)
+		u = 0;
+	auto v = asin(glm::clamp(position.y, -1.f, 1.f)) / glm::pi<float>() + 0.5f;
+	return glm::vec2(u, v);
+}
+
+// Sets the texture coordinates of a unit sphere. Triangles across the seam get copies of their
+// vertices at u + 1, and pole vertices get a copy per triangle at the middle of the other two corners.
+static void SetEquirectangularUVs(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices
+)
+{
+	const GLuint unassigned = ~0u;
+	const float pole_tolerance = 1e-6f;
+
+	uvs.resize(positions.size());
+	for (size_t v = 0; v < positions.size(); ++v)
+		uvs[v] = EquirectangularUV(positions[v]);
+
+	auto IsPole = [&](GLuint v)
+	{
+		return glm::abs(positions[v].x) <= pole_tolerance && glm::abs(positions[v].z) <= pole_tolerance;
+	};
+	auto AddCopy = [&](GLuint v, glm::vec2 uv)
 	{
-		return (r % rotation_segments) * vertical_segments + v;
+		auto position = positions[v];
+		auto normal = normals[v];
+		positions.push_back(position);
+		normals.push_back(normal);
+		uvs.push_back(uv);
+		return GLuint(positions.size() - 1);
 	};
-	indices.reserve(rotation_segments * (vertical_segments - 1) * 6);
-	for (int r = 0; r < rotation_segments - 1; ++r)
-		for (int v = 0; v < vertical_segments - 1; ++v)
+
+	std::vector<GLuint> seam_copies(positions.size(), unassigned);
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		auto triangle = &indices[t];
+
+		float min_u = 1, max_u = 0;
+		for (int k = 0; k < 3; ++k)
+			if (!IsPole(triangle[k]))
+			{
+				min_u = glm::min(min_u, uvs[triangle[k]].x);
+				max_u = glm::max(max_u, uvs[triangle[k]].x);
+			}
+
+		if (max_u - min_u > 0.5f)
+			for (int k = 0; k < 3; ++k)
+				if (!IsPole(triangle[k]) && uvs[triangle[k]].x < 0.5f)
+				{
+					if (seam_copies[triangle[k]] == unassigned)
+						seam_copies[triangle[k]] = AddCopy(triangle[k], uvs[triangle[k]] + glm::vec2(1, 0));
+					triangle[k] = seam_copies[triangle[k]];
+				}
+
+		for (int k = 0; k < 3; ++k)
+			if (IsPole(triangle[k]))
+			{
+				auto u = (uvs[triangle[(k + 1) % 3]].x + uvs[triangle[(k + 2) % 3]].x) / 2;
+				triangle[k] = AddCopy(triangle[k], glm::vec2(u, uvs[triangle[k]].y));
+			}
+	}
+}
+
+void GenerateIcosphere(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	int subdivisions
+)
+{
+	positions.clear();
+	indices.clear();
+
+	// Poles, then two rings of 5 vertices rotated by half a step against each other
+	auto ring_y = float(1 / sqrt(5.));
+	auto ring_radius = float(2 / sqrt(5.));
+	positions.push_back(glm::vec3(0, 1, 0));
+	for (int ring = 0; ring < 2; ++ring)
+		for (int i = 0; i < 5; ++i)
+		{
+			auto angle = (i + ring * 0.5f) / 5 * glm::two_pi<float>();
+			positions.push_back(glm::vec3(ring_radius * cos(angle), ring == 0 ? ring_y : -ring_y, -ring_radius * sin(angle)));
+		}
+	positions.push_back(glm::vec3(0, -1, 0));
+
+	for (int i = 0; i < 5; ++i)
+	{
+		GLuint upper = 1 + i, next_upper = 1 + (i + 1) % 5;
+		GLuint lower = 6 + i, next_lower = 6 + (i + 1) % 5;
+		AddSphereTriangle(indices, positions, 0, upper, next_upper);
+		AddSphereTriangle(indices, positions, upper, lower, next_upper);
+		AddSphereTriangle(indices, positions, next_upper, lower, next_lower);
+		AddSphereTriangle(indices, positions, lower, 11, next_lower);
+	}
+
+	// Splitting keeps the winding, the middle of each edge is shared by its two triangles
+	std::unordered_map<unsigned long long, GLuint> edge_middles;
+	std::vector<GLuint> next_indices;
+	for (int s = 0; s < subdivisions; ++s)
+	{
+		edge_middles.clear();
+		edge_middles.reserve(indices.size());
+		next_indices.clear();
+		next_indices.reserve(indices.size() * 4);
+
+		auto EdgeMiddle = [&](GLuint a, GLuint b)
 		{
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v, r + 1));
-			indices.push_back(VRtoIndex(v, r));
+			auto key = (unsigned long long)(glm::min(a, b)) << 32 | glm::max(a, b);
+			auto found = edge_middles.find(key);
+			if (found != edge_middles.end())
+				return found->second;
 
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v + 1, r + 1));
-			indices.push_back(VRtoIndex(v, r + 1));
+			auto middle = GLuint(positions.size());
+			positions.push_back(glm::normalize(positions[a] + positions[b]));
+			edge_middles[key] = middle;
+			return middle;
+		};
+
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			auto a = indices[t], b = indices[t + 1], c = indices[t + 2];
+			auto ab = EdgeMiddle(a, b), bc = EdgeMiddle(b, c), ca = EdgeMiddle(c, a);
+			GLuint triangles[] = { a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca };
+			next_indices.insert(next_indices.end(), triangles, triangles + 12);
 		}
+
+		indices.swap(next_indices);
+	}
+
+	normals = positions;
+	SetEquirectangularUVs(positions, normals, uvs, indices);
 }
 
-void GenerateParametricShapeFrom3D(
+void GenerateCubeSphere(
 	std::vector<glm::vec3>& positions,
 	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
 	std::vector<GLuint>& indices,
-	glm::dvec3(*parametric_surface)(double, double),
-	int vertical_segments,
-	int rotation_segments
+	int face_segments
 )
 {
-	positions.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
-			positions.push_back(parametric_surface(v / double(vertical_segments - 1), r / double(rotation_segments)));
+	int n = glm::max(face_segments + face_segments % 2, 2);
 
-	normals.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
+	positions.clear();
+	indices.clear();
+	indices.reserve(size_t(6) * n * n * 6);
+
+	// Vertices on the cube edges are shared between faces, they are found by their
+	// doubled lattice coordinates, which are integers in [0, 2n]
+	std::unordered_map<unsigned long long, GLuint> lattice_vertices;
+	lattice_vertices.reserve(size_t(6) * (n + 1) * (n + 1));
+	auto LatticeVertex = [&](glm::ivec3 lattice)
+	{
+		auto key = ((unsigned long long)(lattice.x) * (2 * n + 1) + lattice.y) * (2 * n + 1) + lattice.z;
+		auto found = lattice_vertices.find(key);
+		if (found != lattice_vertices.end())
+			return found->second;
+
+		// Equal angle projection, tan(s * PI/4) spreads the vertices evenly over the sphere
+		auto cube = glm::vec3(lattice) / float(n) - 1.f;
+		auto warped = glm::vec3(tan(cube.x * glm::quarter_pi<float>()), tan(cube.y * glm::quarter_pi<float>()), tan(cube.z * glm::quarter_pi<float>()));
+
+		auto vertex = GLuint(positions.size());
+		positions.push_back(glm::normalize(warped));
+		lattice_vertices[key] = vertex;
+		return vertex;
+	};
+
+	glm::ivec3 axes[] = { glm::ivec3(1, 0, 0), glm::ivec3(0, 1, 0), glm::ivec3(0, 0, 1) };
+	for (int face = 0; face < 6; ++face)
+	{
+		auto normal = axes[face / 2] * (face % 2 == 0 ? 1 : -1);
+		auto tangent = axes[(face / 2 + 1) % 3];
+		auto bitangent = axes[(face / 2 + 2) % 3];
+
+		auto FaceVertex = [&](int i, int j)
 		{
-			auto nv = v / double(vertical_segments - 1);
-			auto nr = r / double(rotation_segments);
-			auto epsilonv = 1 / double(vertical_segments - 1);
-			auto epsilonr = 1 / double(rotation_segments);
+			return LatticeVertex(n * (glm::ivec3(1) + normal) + (2 * i - n) * tangent + (2 * j - n) * bitangent);
+		};
 
-			auto to_next_v = parametric_surface(nv + epsilonv, nr) - parametric_surface(nv, nr);
-			auto from_prev_v = parametric_surface(nv, nr) - parametric_surface(nv - epsilonv, nr);
-			auto tangent_v = (to_next_v + from_prev_v) / 2.;
+		for (int i = 0; i < n; ++i)
+			for (int j = 0; j < n; ++j)
+			{
+				auto a = FaceVertex(i, j), b = FaceVertex(i + 1, j);
+				auto c = FaceVertex(i + 1, j + 1), d = FaceVertex(i, j + 1);
+				AddSphereTriangle(indices, positions, a, b, c);
+				AddSphereTriangle(indices, positions, a, c, d);
+			}
+	}
 
-			auto to_next_r = parametric_surface(nv, nr + epsilonr) - parametric_surface(nv, nr);
-			auto from_prev_r = parametric_surface(nv, nr) - parametric_surface(nv, nr - epsilonr);
-			auto tangent_r = (to_next_r + from_prev_r) / 2.;
+	normals = positions;
+	SetEquirectangularUVs(positions, normals, uvs, indices);
+}
 
-			auto normal = glm::normalize(glm::cross(tangent_r, tangent_v));
-			normals.push_back(normal);
-		}
+/* Generator Helper Functions */
+std::vector<ParametricLineSample> detail::SampleParametricProfile(ParametricLineBatch parametric_line, int vertical_segments)
+{
+	std::vector<double> t(vertical_segments);
+	for (int v = 0; v < vertical_segments; ++v)
+		t[v] = v / double(vertical_segments - 1);
+
+	std::vector<double> x(vertical_segments), y(vertical_segments);
+	std::vector<double> tangent_x(vertical_segments), tangent_y(vertical_segments);
+	parametric_line(t.data(), vertical_segments, x.data(), y.data(), tangent_x.data(), tangent_y.data());
+
+	std::vector<ParametricLineSample> profile(vertical_segments);
+	for (int v = 0; v < vertical_segments; ++v)
+	{
+		profile[v].position = glm::dvec2(x[v], y[v]);
+		profile[v].tangent = glm::dvec2(tangent_x[v], tangent_y[v]);
+	}
+	return profile;
+}
+
+int detail::RotationSegmentsForError(double max_radius, double max_error)
+{
+	// A segment of angle a deviates from its arc by max_radius * (1 - cos(a / 2))
+	if (max_error >= max_radius)
+		return 4;
 
+	auto segments = int(ceil(glm::pi<double>() / acos(1 - max_error / max_radius)));
+	return glm::max(segments + 1, 4);
+}
+
+void detail::WriteRingIndices(GLuint* ring_indices, int r, int vertical_segments, int rotation_segments)
+{
 	auto VRtoIndex = [vertical_segments, rotation_segments](int v, int r)
 	{
-		return (r % rotation_segments) * vertical_segments + v;
+		return GLuint((r % rotation_segments) * vertical_segments + v);
 	};
-	indices.reserve(rotation_segments * (vertical_segments - 1) * 6);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments - 1; ++v)
-		{
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v, r + 1));
-			indices.push_back(VRtoIndex(v, r));
+	for (int v = 0; v < vertical_segments - 1; ++v)
+	{
+		*ring_indices++ = VRtoIndex(v + 1, r);
+		*ring_indices++ = VRtoIndex(v, r + 1);
+		*ring_indices++ = VRtoIndex(v, r);
 
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v + 1, r + 1));
-			indices.push_back(VRtoIndex(v, r + 1));
-		}
+		*ring_indices++ = VRtoIndex(v + 1, r);
+		*ring_indices++ = VRtoIndex(v + 1, r + 1);
+		*ring_indices++ = VRtoIndex(v, r + 1);
+	}
 }
 
 /* Example 2D Parametric Functions */
@@ -156,4 +569,154 @@ glm::dvec2 ParametricSpikes(double t)
 	auto r = 0.3;
 	auto a = 2 + 4 * 2;
 	return (glm::dvec2(cos(t) + sin(a*t) / a, sin(t) + cos(a*t) / a)) * r + c;
-};
\ No newline at end of file
+};
+
+/* Example 2D Parametric Functions With Tangents */
+ParametricLineSample ParametricHalfCircleWithTangent(double t)
+{
+	t -= 0.5;
+	t *= glm::pi<double>();
+
+	ParametricLineSample sample;
+	sample.position = glm::dvec2(cos(t), sin(t));
+	sample.tangent = glm::dvec2(-sin(t), cos(t)) * glm::pi<double>();
+	return sample;
+};
+
+ParametricLineSample ParametricCircleWithTangent(double t)
+{
+	t -= 0.5;
+	t *= glm::two_pi<double>();
+
+	auto c = glm::dvec2(0.7, 0);
+	auto r = 0.3;
+
+	ParametricLineSample sample;
+	sample.position = glm::dvec2(cos(t), sin(t)) * r + c;
+	sample.tangent = glm::dvec2(-sin(t), cos(t)) * r * glm::two_pi<double>();
+	return sample;
+};
+
+ParametricLineSample ParametricSpikesWithTangent(double t)
+{
+	t -= 0.5;
+	t *= glm::two_pi<double>();
+
+	auto c = glm::dvec2(0.7, 0);
+	auto r = 0.3;
+	auto a = 2 + 4 * 2;
+
+	ParametricLineSample sample;
+	sample.position = (glm::dvec2(cos(t) + sin(a*t) / a, sin(t) + cos(a*t) / a)) * r + c;
+	sample.tangent = (glm::dvec2(-sin(t) + cos(a*t), cos(t) - sin(a*t))) * r * glm::two_pi<double>();
+	return sample;
+};
+
+/* Batched Parametric Functions */
+
+// Parameters are processed in chunks of this size, so temporaries stay on the stack
+static const int batch_chunk_size = 256;
+
+// Cody-Waite reduction to [-PI/4, PI/4] followed by the fdlibm kernel polynomials.
+// There are no branches or calls in the loop, so it is vectorized by the compiler.
+void SinCosBatch(const double* angles, int count, double* sines, double* cosines)
+{
+	const double two_over_pi = 6.36619772367581382433e-01;
+	const double pi_over_2_high = 1.57079632673412561417e+00;
+	const double pi_over_2_low = 6.07710050650619224932e-11;
+	const double round_to_nearest = 6755399441055744.0; // 1.5 * 2^52
+
+	for (int i = 0; i < count; ++i)
+	{
+		auto quadrant = (angles[i] * two_over_pi + round_to_nearest) - round_to_nearest;
+		auto x = (angles[i] - quadrant * pi_over_2_high) - quadrant * pi_over_2_low;
+		auto z = x * x;
+
+		auto s = x + x * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04
+			+ z * (2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+		auto c = 1 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05
+			+ z * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+
+		// sin(x + q * PI/2) and cos(x + q * PI/2) only depend on q mod 4
+		auto q = int(quadrant);
+		auto sine = (q & 1) ? c : s;
+		auto cosine = (q & 1) ? s : c;
+		sines[i] = (q & 2) ? -sine : sine;
+		cosines[i] = ((q + 1) & 2) ? -cosine : cosine;
+	}
+}
+
+void ParametricHalfCircleBatch(const double* t, int count, double* x, double* y, double* tangent_x, double* tangent_y)
+{
+	double angles[batch_chunk_size], sines[batch_chunk_size], cosines[batch_chunk_size];
+	for (int begin = 0; begin < count; begin += batch_chunk_size)
+	{
+		int chunk_size = glm::min(batch_chunk_size, count - begin);
+		for (int i = 0; i < chunk_size; ++i)
+			angles[i] = (t[begin + i] - 0.5) * glm::pi<double>();
+
+		SinCosBatch(angles, chunk_size, sines, cosines);
+
+		for (int i = 0; i < chunk_size; ++i)
+		{
+			x[begin + i] = cosines[i];
+			y[begin + i] = sines[i];
+			tangent_x[begin + i] = -sines[i] * glm::pi<double>();
+			tangent_y[begin + i] = cosines[i] * glm::pi<double>();
+		}
+	}
+}
+
+void ParametricCircleBatch(const double* t, int count, double* x, double* y, double* tangent_x, double* tangent_y)
+{
+	auto c = glm::dvec2(0.7, 0);
+	auto r = 0.3;
+
+	double angles[batch_chunk_size], sines[batch_chunk_size], cosines[batch_chunk_size];
+	for (int begin = 0; begin < count; begin += batch_chunk_size)
+	{
+		int chunk_size = glm::min(batch_chunk_size, count - begin);
+		for (int i = 0; i < chunk_size; ++i)
+			angles[i] = (t[begin + i] - 0.5) * glm::two_pi<double>();
+
+		SinCosBatch(angles, chunk_size, sines, cosines);
+
+		for (int i = 0; i < chunk_size; ++i)
+		{
+			x[begin + i] = cosines[i] * r + c.x;
+			y[begin + i] = sines[i] * r + c.y;
+			tangent_x[begin + i] = -sines[i] * r * glm::two_pi<double>();
+			tangent_y[begin + i] = cosines[i] * r * glm::two_pi<double>();
+		}
+	}
+}
+
+void ParametricSpikesBatch(const double* t, int count, double* x, double* y, double* tangent_x, double* tangent_y)
+{
+	auto c = glm::dvec2(0.7, 0);
+	auto r = 0.3;
+	auto a = 2 + 4 * 2;
+
+	double angles[batch_chunk_size], sines[batch_chunk_size], cosines[batch_chunk_size];
+	double spike_angles[batch_chunk_size], spike_sines[batch_chunk_size], spike_cosines[batch_chunk_size];
+	for (int begin = 0; begin < count; begin += batch_chunk_size)
+	{
+		int chunk_size = glm::min(batch_chunk_size, count - begin);
+		for (int i = 0; i < chunk_size; ++i)
+		{
+			angles[i] = (t[begin + i] - 0.5) * glm::two_pi<double>();
+			spike_angles[i] = angles[i] * a;
+		}
+
+		SinCosBatch(angles, chunk_size, sines, cosines);
+		SinCosBatch(spike_angles, chunk_size, spike_sines, spike_cosines);
+
+		for (int i = 0; i < chunk_size; ++i)
+		{
+			x[begin + i] = (cosines[i] + spike_sines[i] / a) * r + c.x;
+			y[begin + i] = (sines[i] + spike_cosines[i] / a) * r + c.y;
+			tangent_x[begin + i] = (-sines[i] + spike_cosines[i]) * r * glm::two_pi<double>();
+			tangent_y[begin + i] = (cosines[i] - spike_sines[i]) * r * glm::two_pi<double>();
+		}
+	}
+}
\ No newline at end of file
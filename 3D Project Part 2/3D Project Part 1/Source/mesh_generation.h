@@ -2,12 +2,69 @@
 
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <algorithm>
 #include "GLM/glm.hpp"
 #include "GLM/gtc/constants.hpp"
 #include "GLM/gtx/rotate_vector.hpp"
 #include "GLAD/glad.h"
 
+/* Parametric Samples */
+
+// Position with its derivative along the profile
+struct ParametricLineSample
+{
+	glm::dvec2 position;
+	glm::dvec2 tangent;
+};
+
+// Position with its partial derivatives along v and r
+struct ParametricSurfaceSample
+{
+	glm::dvec3 position;
+	glm::dvec3 tangent_v;
+	glm::dvec3 tangent_r;
+};
+
+// Batched parametric line, evaluates count parameters at once into structure of arrays outputs
+typedef void(*ParametricLineBatch)(const double* t, int count, double* x, double* y, double* tangent_x, double* tangent_y);
+
+/* Revolution Topology */
+
+// Surfaces of revolution repeat a vertex wherever rings meet: on the axis of rotation,
+// at the seam between the last and first ring, and where a closed profile ends.
+// Value initialized, RevolutionTopology() keeps all of them.
+struct RevolutionTopology
+{
+	// Profile ends on the Y axis become a fan of triangles, instead of a ring of coincident
+	// vertices with degenerate triangles. Every triangle of the fan has its own pole vertex with
+	// the u of its column, so textures are not twisted, or all share one with weld_seam.
+	bool collapse_poles;
+
+	// The last ring reuses the vertices of the first ring, and a profile that ends where it
+	// starts reuses its first sample. The texture coordinates can not wrap around then, so
+	// only use it for untextured meshes. Textured meshes keep just the seam column duplicated.
+	bool weld_seam;
+};
+
+/* Adaptive Sampling */
+
+// Replaces vertical_segments with a target error, so the profile gets as many samples as its
+// curvature needs. initial_segments uniform segments are split until none of them deviates
+// from its chord by more than max_error / 2, or max_depth splits are reached. The rotation gets the
+// fewest segments that keep the widest ring within the other max_error / 2.
+struct AdaptiveSampling
+{
+	double max_error;
+	int initial_segments;
+	int max_depth;
+};
+
 /* Generator Functions */
+
+// Overloads taking position-only functions estimate the derivatives with finite
+// differences, the ones taking samples use the given derivatives directly.
+// The function pointer overloads forward to the templates below.
 void GenerateParametricShapeFrom2D(
 	std::vector<glm::vec3>& positions,
 	std::vector<glm::vec3>& normals,
@@ -15,7 +72,19 @@ void GenerateParametricShapeFrom2D(
 	std::vector<GLuint>& indices,
 	glm::dvec2(*parametric_line)(double),
 	int vertical_segments,
-	int rotation_segments
+	int rotation_segments,
+	RevolutionTopology topology = RevolutionTopology()
+);
+
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLineSample(*parametric_line)(double),
+	int vertical_segments,
+	int rotation_segments,
+	RevolutionTopology topology = RevolutionTopology()
 );
 
 void GenerateParametricShapeFrom3D(
@@ -27,7 +96,241 @@ void GenerateParametricShapeFrom3D(
 	int rotation_segments
 );
 
+void GenerateParametricShapeFrom3D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	ParametricSurfaceSample(*parametric_surface)(double, double),
+	int vertical_segments,
+	int rotation_segments
+);
+
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLineBatch parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	RevolutionTopology topology = RevolutionTopology()
+);
+
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLineBatch parametric_line,
+	AdaptiveSampling sampling,
+	RevolutionTopology topology = RevolutionTopology()
+);
+
+// Profile parameters and rotation segments the overload above picks for the sampling, without the mesh
+std::vector<double> AdaptiveRevolutionParameters(ParametricLineBatch parametric_line, AdaptiveSampling sampling, int& rotation_segments);
+
+// Surface of revolution around the Y axis from profile samples taken at v / (profile.size() - 1)
+void GenerateParametricShapeFromProfile(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	const std::vector<ParametricLineSample>& profile,
+	int rotation_segments,
+	RevolutionTopology topology = RevolutionTopology()
+);
+
+// Same as above for profile samples taken at profile_t, which also becomes the v texture coordinate
+void GenerateParametricShapeFromProfile(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	const std::vector<ParametricLineSample>& profile,
+	const std::vector<double>& profile_t,
+	int rotation_segments,
+	RevolutionTopology topology = RevolutionTopology()
+);
+
+/* Sphere Generator Functions */
+
+// Unit spheres with near uniform triangle areas, as an alternative to the surface of revolution of
+// ParametricHalfCircle, whose vertices crowd around the poles. Texture coordinates follow the same
+// equirectangular mapping, vertices are only duplicated along the u seam and at the poles.
+// Triangles are wound the same way as the surfaces of revolution.
+
+// Icosahedron with a vertex on each pole, every subdivision splits each triangle into 4
+void GenerateIcosphere(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	int subdivisions
+);
+
+// Cube with face_segments x face_segments quads per face, projected with equal angles per quad.
+// face_segments is rounded up to an even number, so the poles are vertices.
+void GenerateCubeSphere(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	int face_segments
+);
+
+/* Generic Generator Functions */
+
+// Take any callable, so the parametric function can be inlined into the vertex loop
+// and can carry state, e.g. a lambda capturing the radius of a torus. The callable
+// returns either a position or a sample with derivatives, same as the overloads above.
+template <typename ParametricLine>
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLine parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	RevolutionTopology topology = RevolutionTopology()
+);
+
+template <typename ParametricLine>
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLine parametric_line,
+	AdaptiveSampling sampling,
+	RevolutionTopology topology = RevolutionTopology()
+);
+
+template <typename ParametricSurface>
+void GenerateParametricShapeFrom3D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	ParametricSurface parametric_surface,
+	int vertical_segments,
+	int rotation_segments
+);
+
 /* Example 2D Parametric Functions */
 glm::dvec2 ParametricHalfCircle(double);
 glm::dvec2 ParametricCircle(double);
-glm::dvec2 ParametricSpikes(double);
\ No newline at end of file
+glm::dvec2 ParametricSpikes(double);
+
+/* Example 2D Parametric Functions With Tangents */
+ParametricLineSample ParametricHalfCircleWithTangent(double);
+ParametricLineSample ParametricCircleWithTangent(double);
+ParametricLineSample ParametricSpikesWithTangent(double);
+
+/* Batched Parametric Functions */
+void SinCosBatch(const double* angles, int count, double* sines, double* cosines);
+
+void ParametricHalfCircleBatch(const double* t, int count, double* x, double* y, double* tangent_x, double* tangent_y);
+void ParametricCircleBatch(const double* t, int count, double* x, double* y, double* tangent_x, double* tangent_y);
+void ParametricSpikesBatch(const double* t, int count, double* x, double* y, double* tangent_x, double* tangent_y);
+
+// Helpers of the definitions below and of the streaming and compute generators, not part of the interface
+#include "mesh_generation_detail.h"
+
+/* Generic Generator Function Definitions */
+template <typename ParametricLine>
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLine parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	RevolutionTopology topology
+)
+{
+	using Result = decltype(parametric_line(0.));
+
+	std::vector<ParametricLineSample> profile(vertical_segments);
+	for (int v = 0; v < vertical_segments; ++v)
+		profile[v] = detail::SampleParametricLine(
+			parametric_line, v / double(vertical_segments - 1), 1 / double(vertical_segments - 1), Result());
+
+	GenerateParametricShapeFromProfile(positions, normals, uvs, indices, profile, rotation_segments, topology);
+}
+
+template <typename ParametricLine>
+void GenerateParametricShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	ParametricLine parametric_line,
+	AdaptiveSampling sampling,
+	RevolutionTopology topology
+)
+{
+	using Result = decltype(parametric_line(0.));
+
+	auto profile_t = detail::AdaptiveProfileParameters([&](const double* t, int count, double* x, double* y)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			auto position = detail::ParametricLinePosition(parametric_line(t[i]));
+			x[i] = position.x;
+			y[i] = position.y;
+		}
+	}, sampling);
+
+	// Finite differences over a fixed small step, the sample spacing is not uniform anymore
+	double max_radius = 0;
+	std::vector<ParametricLineSample> profile(profile_t.size());
+	for (size_t v = 0; v < profile.size(); ++v)
+	{
+		profile[v] = detail::SampleParametricLine(parametric_line, profile_t[v], 1e-5, Result());
+		max_radius = glm::max(max_radius, glm::abs(profile[v].position.x));
+	}
+
+	auto rotation_segments = detail::RotationSegmentsForError(max_radius, sampling.max_error / 2);
+	GenerateParametricShapeFromProfile(positions, normals, uvs, indices, profile, profile_t, rotation_segments, topology);
+}
+
+// Closed in r, samples are taken at (v / (vertical_segments - 1), r / rotation_segments)
+template <typename ParametricSurface>
+void GenerateParametricShapeFrom3D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	ParametricSurface parametric_surface,
+	int vertical_segments,
+	int rotation_segments
+)
+{
+	using Result = decltype(parametric_surface(0., 0.));
+
+	positions.resize(vertical_segments * rotation_segments);
+	normals.resize(vertical_segments * rotation_segments);
+	indices.resize(rotation_segments * (vertical_segments - 1) * 6);
+
+	detail::ParallelFor(rotation_segments, [&](int begin, int end)
+	{
+		// Each thread gets its own copy of stateful callables
+		auto surface = parametric_surface;
+		auto epsilonv = 1 / double(vertical_segments - 1);
+		auto epsilonr = 1 / double(rotation_segments);
+
+		for (int r = begin; r < end; ++r)
+		{
+			for (int v = 0; v < vertical_segments; ++v)
+			{
+				auto i = r * vertical_segments + v;
+				auto sample = detail::SampleParametricSurface(
+					surface, v / double(vertical_segments - 1), r / double(rotation_segments), epsilonv, epsilonr, Result());
+				positions[i] = sample.position;
+				normals[i] = glm::normalize(glm::cross(sample.tangent_r, sample.tangent_v));
+			}
+
+			detail::WriteRingIndices(&indices[r * (vertical_segments - 1) * 6], r, vertical_segments, rotation_segments);
+		}
+	});
+}
\ No newline at end of file
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+// Internals of the generators in mesh_generation.h, shared with the streaming and compute
+// generators. Only included by mesh_generation.h, after the types they use.
+
+namespace detail
+{
+
+/* Surface of Revolution Layout */
+
+// Where the vertices and indices of a surface of revolution go. Ring r holds the profile rows
+// [first_row, end_row) starting at vertex r * ring_vertex_count, the poles are stored after the
+// rings, pole_vertex_count vertices each. Column r holds the column_triangle_count triangles
+// between rings r and r + 1.
+struct RevolutionLayout
+{
+	int vertical_segments;
+	int rotation_segments;
+
+	bool first_pole;
+	bool last_pole;
+	bool closed_profile;
+
+	int first_row;
+	int end_row;
+	int ring_vertex_count;
+	int ring_count;
+	int pole_base;
+	int column_triangle_count;
+
+	// A pole has a vertex per column, with the u of the middle of the column, so the texture is not
+	// twisted around the pole. With a welded seam the texture coordinates do not matter and one is enough.
+	int pole_vertex_count;
+
+	int vertex_count;
+	size_t index_count;
+
+	// Profile in structure of arrays, and the rotation of every ring
+	std::vector<float> profile_x, profile_y;
+	std::vector<float> profile_normal_x, profile_normal_y;
+	std::vector<float> profile_v;
+	std::vector<float> cosines, sines;
+
+	float max_radius;
+	float min_y, max_y;
+
+	// Profile samples closer than this to the axis are on it
+	float axis_tolerance;
+};
+
+/* Generator Helper Functions */
+
+// Splits [0, count) into contiguous blocks and runs body(begin, end) for each of
+// them on its own thread. The calling thread takes the last block.
+template <typename Body>
+void ParallelFor(int count, Body body)
+{
+	int thread_count = glm::clamp(int(std::thread::hardware_concurrency()), 1, glm::max(count, 1));
+	int block_size = (count + thread_count - 1) / thread_count;
+
+	std::vector<std::thread> workers;
+	workers.reserve(thread_count - 1);
+	for (int begin = 0; begin + block_size < count; begin += block_size)
+		workers.emplace_back(body, begin, begin + block_size);
+
+	body(int(workers.size()) * block_size, count);
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+// Writes the two triangles of each quad between rings r and r + 1 to the 6 * (vertical_segments - 1)
+// indices that belong to ring r. Ring rotation_segments wraps around to ring 0.
+void WriteRingIndices(GLuint* ring_indices, int r, int vertical_segments, int rotation_segments);
+
+// Samples the profile from t = v / (vertical_segments - 1) for the layout
+std::vector<ParametricLineSample> SampleParametricProfile(ParametricLineBatch parametric_line, int vertical_segments);
+
+RevolutionLayout PlanRevolution(
+	const std::vector<ParametricLineSample>& profile,
+	const std::vector<double>& profile_t,
+	int rotation_segments,
+	RevolutionTopology topology
+);
+
+inline GLuint RevolutionPoleIndex(const RevolutionLayout& layout, bool last_pole, int column)
+{
+	auto first_vertex = layout.pole_base + (last_pole && layout.first_pole ? layout.pole_vertex_count : 0);
+	return GLuint(first_vertex + column % layout.pole_vertex_count);
+}
+
+// Vertex v of ring r, on a pole row the pole vertex of the column
+inline GLuint RevolutionVertexIndex(const RevolutionLayout& layout, int v, int r, int column)
+{
+	if (v == 0 && layout.first_pole)
+		return RevolutionPoleIndex(layout, false, column);
+	if (v == layout.vertical_segments - 1 && layout.last_pole)
+		return RevolutionPoleIndex(layout, true, column);
+	if (v == layout.vertical_segments - 1 && layout.closed_profile)
+		v = 0;
+	return GLuint((r % layout.ring_count) * layout.ring_vertex_count + v - layout.first_row);
+}
+
+// Writes the triangles of column r between rows v_begin and v_end, returns the end of the written indices.
+// The quads touching a pole lose the triangle whose two pole corners would be the same vertex.
+inline GLuint* WriteRevolutionTriangles(const RevolutionLayout& layout, int r, int v_begin, int v_end, GLuint* indices)
+{
+	for (int v = v_begin; v < v_end; ++v)
+	{
+		if (v != 0 || !layout.first_pole)
+		{
+			*indices++ = RevolutionVertexIndex(layout, v + 1, r, r);
+			*indices++ = RevolutionVertexIndex(layout, v, r + 1, r);
+			*indices++ = RevolutionVertexIndex(layout, v, r, r);
+		}
+
+		if (v != layout.vertical_segments - 2 || !layout.last_pole)
+		{
+			*indices++ = RevolutionVertexIndex(layout, v + 1, r, r);
+			*indices++ = RevolutionVertexIndex(layout, v + 1, r + 1, r);
+			*indices++ = RevolutionVertexIndex(layout, v, r + 1, r);
+		}
+	}
+	return indices;
+}
+
+// Calls write_vertex(index, position, normal, uv) for the vertices of ring r, r < layout.ring_count
+template <typename WriteVertex>
+void WriteRevolutionRing(const RevolutionLayout& layout, int r, WriteVertex& write_vertex)
+{
+	// Same as glm::rotateY for a point on the XY plane
+	auto c = layout.cosines[r];
+	auto s = layout.sines[r];
+	auto u = float(r / double(layout.rotation_segments - 1));
+
+	auto first_vertex = GLuint(r * layout.ring_vertex_count - layout.first_row);
+	for (int v = layout.first_row; v < layout.end_row; ++v)
+	{
+		auto x = layout.profile_x[v];
+		auto normal_x = layout.profile_normal_x[v];
+		write_vertex(
+			first_vertex + v,
+			glm::vec3(x * c, layout.profile_y[v], -x * s),
+			glm::vec3(normal_x * c, layout.profile_normal_y[v], -normal_x * s),
+			glm::vec2(u, layout.profile_v[v]));
+	}
+}
+
+// Calls write_vertex(index, position, normal, uv) for the pole vertices, they are the last ones.
+// A single pole vertex has no meaningful u, the middle of the texture keeps the fan symmetric.
+template <typename WriteVertex>
+void WriteRevolutionPoles(const RevolutionLayout& layout, WriteVertex& write_vertex)
+{
+	for (int v = 0; v < layout.vertical_segments; v += layout.vertical_segments - 1)
+		if ((v == 0 && layout.first_pole) || (v != 0 && layout.last_pole))
+			for (int column = 0; column < layout.pole_vertex_count; ++column)
+			{
+				auto u = layout.pole_vertex_count == 1 ? 0.5f : float((column + 0.5) / (layout.rotation_segments - 1));
+				write_vertex(
+					RevolutionPoleIndex(layout, v != 0, column),
+					glm::vec3(0, layout.profile_y[v], 0),
+					glm::vec3(0, layout.profile_normal_y[v] < 0 ? -1 : 1, 0),
+					glm::vec2(u, layout.profile_v[v]));
+			}
+}
+
+// Fewest rotation segments whose chord deviation at max_radius stays under max_error
+int RotationSegmentsForError(double max_radius, double max_error);
+
+inline glm::dvec2 ParametricLinePosition(const glm::dvec2& position)
+{
+	return position;
+}
+
+inline glm::dvec2 ParametricLinePosition(const ParametricLineSample& sample)
+{
+	return sample.position;
+}
+
+// Profile parameters in [0, 1] for AdaptiveSampling. evaluate_positions(t, count, x, y) evaluates
+// the profile at count parameters, all segments of a subdivision step are evaluated in one call.
+// The deviation of a segment is measured at its quarter, half and three quarter points.
+template <typename EvaluatePositions>
+std::vector<double> AdaptiveProfileParameters(EvaluatePositions evaluate_positions, AdaptiveSampling sampling)
+{
+	struct Segment
+	{
+		double t0, t1;
+		int depth;
+	};
+
+	const int points_per_segment = 5;
+	auto max_deviation = sampling.max_error / 2;
+
+	// Uniform start, so features narrower than the whole profile are not skipped by the first chord
+	std::vector<Segment> pending, next_pending, accepted;
+	int initial_segments = glm::max(sampling.initial_segments, 1);
+	for (int i = 0; i < initial_segments; ++i)
+		pending.push_back(Segment{ i / double(initial_segments), (i + 1) / double(initial_segments), 0 });
+
+	std::vector<double> t, x, y;
+	while (!pending.empty())
+	{
+		// Both ends and the quarter points of every segment
+		auto count = int(pending.size()) * points_per_segment;
+		t.resize(count);
+		x.resize(count);
+		y.resize(count);
+		for (size_t s = 0; s < pending.size(); ++s)
+			for (int k = 0; k < points_per_segment; ++k)
+				t[s * points_per_segment + k] = pending[s].t0 + (pending[s].t1 - pending[s].t0) * k / (points_per_segment - 1);
+		evaluate_positions(t.data(), count, x.data(), y.data());
+
+		next_pending.clear();
+		for (size_t s = 0; s < pending.size(); ++s)
+		{
+			auto points = s * points_per_segment;
+			auto p0 = glm::dvec2(x[points], y[points]);
+			auto chord = glm::dvec2(x[points + points_per_segment - 1], y[points + points_per_segment - 1]) - p0;
+			auto length2 = glm::dot(chord, chord);
+
+			double deviation = 0;
+			for (int k = 1; k < points_per_segment - 1; ++k)
+			{
+				auto point = glm::dvec2(x[points + k], y[points + k]);
+				auto along = length2 > 0 ? glm::clamp(glm::dot(point - p0, chord) / length2, 0., 1.) : 0.;
+				deviation = glm::max(deviation, glm::length(point - (p0 + chord * along)));
+			}
+
+			auto& segment = pending[s];
+			if (deviation <= max_deviation || segment.depth >= sampling.max_depth)
+			{
+				accepted.push_back(segment);
+				continue;
+			}
+
+			// The deviation of a smooth curve shrinks with the square of the segment length, so splitting
+			// into this many parts is expected to meet the limit in one step. Aiming a bit under the limit
+			// keeps parts that land right at it from being split once more.
+			auto parts = glm::clamp(int(ceil(sqrt(deviation / (0.8 * max_deviation)))), 2, 4096);
+			for (int k = 0; k < parts; ++k)
+			{
+				auto t0 = segment.t0 + (segment.t1 - segment.t0) * k / parts;
+				auto t1 = segment.t0 + (segment.t1 - segment.t0) * (k + 1) / parts;
+				next_pending.push_back(Segment{ t0, t1, segment.depth + 1 });
+			}
+		}
+
+		std::swap(pending, next_pending);
+	}
+
+	std::sort(accepted.begin(), accepted.end(), [](const Segment& a, const Segment& b) { return a.t0 < b.t0; });
+
+	std::vector<double> parameters;
+	parameters.reserve(accepted.size() + 1);
+	for (auto& segment : accepted)
+		parameters.push_back(segment.t0);
+	parameters.push_back(1);
+	return parameters;
+}
+
+// Finite differences for position-only functions, kept inside [0, 1]
+template <typename ParametricLine>
+ParametricLineSample SampleParametricLine(ParametricLine& parametric_line, double t, double epsilon, glm::dvec2)
+{
+	auto prev_t = glm::max(t - epsilon, 0.);
+	auto next_t = glm::min(t + epsilon, 1.);
+
+	ParametricLineSample sample;
+	sample.position = parametric_line(t);
+	sample.tangent = (parametric_line(next_t) - parametric_line(prev_t)) / (next_t - prev_t);
+	return sample;
+}
+
+template <typename ParametricLine>
+ParametricLineSample SampleParametricLine(ParametricLine& parametric_line, double t, double, ParametricLineSample)
+{
+	return parametric_line(t);
+}
+
+// Finite differences for position-only functions, v is kept inside [0, 1] and r wraps around
+template <typename ParametricSurface>
+ParametricSurfaceSample SampleParametricSurface(
+	ParametricSurface& parametric_surface, double v, double r, double epsilonv, double epsilonr, glm::dvec3)
+{
+	auto prev_v = glm::max(v - epsilonv, 0.);
+	auto next_v = glm::min(v + epsilonv, 1.);
+
+	ParametricSurfaceSample sample;
+	sample.position = parametric_surface(v, r);
+	sample.tangent_v = (parametric_surface(next_v, r) - parametric_surface(prev_v, r)) / (next_v - prev_v);
+	sample.tangent_r = (parametric_surface(v, r + epsilonr) - parametric_surface(v, r - epsilonr)) / (2 * epsilonr);
+	return sample;
+}
+
+template <typename ParametricSurface>
+ParametricSurfaceSample SampleParametricSurface(
+	ParametricSurface& parametric_surface, double v, double r, double, double, ParametricSurfaceSample)
+{
+	return parametric_surface(v, r);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "mesh_indirect.h"
+
+#include <iostream>
+#include <cstddef>
+
+#include "uniform_buffers.h"
+
+/* Indirect Drawing Constants */
+
+// Draw data of one IndirectDraws block, the 16 KB every GL supports. Same as the size of
+// u_indirect_draws in the vertex shader, which takes two vec4s per draw.
+static const int draws_per_block = 512;
+
+/* Indirect Drawing Functions */
+bool IndirectDrawsSupported()
+{
+	return GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance && GLAD_GL_ARB_shader_draw_parameters;
+}
+
+void BindEmptyIndirectDrawData()
+{
+	std::vector<IndirectDrawData> draw_data(draws_per_block, IndirectDrawData());
+
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, draw_data.size() * sizeof(IndirectDrawData), draw_data.data(), GL_STATIC_DRAW);
+	BindIndirectDrawData(buffer, 0, draw_data.size() * sizeof(IndirectDrawData));
+}
+
+IndirectMeshBuffer CreateIndirectMeshBuffer(const std::vector<const VAO*>& vaos)
+{
+	IndirectMeshBuffer buffer = {};
+
+	// Every mesh follows the one before it in both buffers
+	GLsizeiptr vertex_count = 0;
+	GLsizeiptr index_count = 0;
+	for (auto vao : vaos)
+	{
+		IndirectMesh mesh = {};
+		if (vao->layout != VertexLayout::InterleavedQuantized)
+		{
+			std::cout << "Meshes of other layouts than InterleavedQuantized are not drawn indirectly." << std::endl;
+			buffer.meshes.push_back(mesh);
+			continue;
+		}
+
+		mesh.source_vao = vao->id;
+		mesh.first_index = GLuint(index_count);
+		mesh.index_count = vao->element_array_count;
+		mesh.base_vertex = GLint(vertex_count);
+		mesh.position_scale = vao->position_scale;
+		mesh.position_offset = vao->position_offset;
+		buffer.meshes.push_back(mesh);
+
+		vertex_count += vao->vertex_count;
+		index_count += vao->element_array_count;
+	}
+
+	glGenVertexArrays(1, &buffer.vao);
+	glBindVertexArray(buffer.vao);
+
+	// Same attributes as VertexLayout::InterleavedQuantized
+	glGenBuffers(1, &buffer.vertex_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(QuantizedVertex), nullptr, GL_STATIC_DRAW);
+
+	auto stride = GLsizei(sizeof(QuantizedVertex));
+	glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(QuantizedVertex, position)));
+	glEnableVertexAttribArray(0);
+
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(QuantizedVertex, normal)));
+	glEnableVertexAttribArray(1);
+
+	glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(QuantizedVertex, uv)));
+	glEnableVertexAttribArray(2);
+
+	glGenBuffers(1, &buffer.index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+
+	// The meshes are copied on the GPU, their vertices and indices are not on the CPU anymore
+	for (size_t i = 0; i < vaos.size(); ++i)
+	{
+		auto& mesh = buffer.meshes[i];
+		if (mesh.source_vao == 0)
+			continue;
+
+		glBindBuffer(GL_COPY_READ_BUFFER, vaos[i]->interleaved_buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.vertex_buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+			GLintptr(mesh.base_vertex) * sizeof(QuantizedVertex), GLsizeiptr(vaos[i]->vertex_count) * sizeof(QuantizedVertex));
+
+		glBindBuffer(GL_COPY_READ_BUFFER, vaos[i]->element_array_buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.index_buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+			GLintptr(mesh.first_index) * sizeof(GLuint), GLsizeiptr(mesh.index_count) * sizeof(GLuint));
+	}
+
+	glGenBuffers(1, &buffer.command_buffer);
+	glGenBuffers(1, &buffer.draw_data_buffer);
+
+	buffer.instances = CreateInstanceBatch();
+	AttachInstanceBatch(buffer.instances, buffer.vao);
+	return buffer;
+}
+
+int FindIndirectMesh(const IndirectMeshBuffer& buffer, GLuint vao)
+{
+	for (size_t i = 0; i < buffer.meshes.size(); ++i)
+		if (buffer.meshes[i].source_vao == vao && vao != 0)
+			return int(i);
+	return -1;
+}
+
+int AddIndirectInstances(IndirectMeshBuffer& buffer, const std::vector<MeshInstance>& instances)
+{
+	auto base_instance = int(buffer.instances.instances.size());
+	buffer.instances.instances.insert(buffer.instances.instances.end(), instances.begin(), instances.end());
+	return base_instance;
+}
+
+void AddIndirectDraw(
+	IndirectMeshBuffer& buffer,
+	int mesh,
+	GLuint base_instance,
+	GLsizei instance_count,
+	GLuint first_index,
+	GLsizei index_count
+)
+{
+	auto& source = buffer.meshes[mesh];
+
+	DrawElementsIndirectCommand command;
+	command.count = GLuint(index_count < 0 ? source.index_count : index_count);
+	command.instance_count = GLuint(instance_count);
+	command.first_index = source.first_index + first_index;
+	command.base_vertex = source.base_vertex;
+	command.base_instance = base_instance;
+	buffer.commands.push_back(command);
+
+	IndirectDrawData draw_data;
+	draw_data.position_scale = glm::vec4(source.position_scale, 0);
+	draw_data.position_offset = glm::vec4(source.position_offset, 0);
+	buffer.draw_data.push_back(draw_data);
+}
+
+int DrawIndirect(IndirectMeshBuffer& buffer)
+{
+	if (buffer.commands.empty())
+		return 0;
+
+	// New stores every frame, so the driver does not wait for the draws of the last one
+	UploadInstanceBatch(buffer.instances);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer.command_buffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, buffer.commands.size() * sizeof(DrawElementsIndirectCommand), buffer.commands.data(), GL_STREAM_DRAW);
+
+	// Blocks are whole, so every block starts at a multiple of 16 KB, which meets any offset alignment
+	auto command_count = int(buffer.commands.size());
+	auto block_count = (command_count + draws_per_block - 1) / draws_per_block;
+	auto block_size = GLsizeiptr(draws_per_block * sizeof(IndirectDrawData));
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer.draw_data_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, block_size * block_count, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, buffer.draw_data.size() * sizeof(IndirectDrawData), buffer.draw_data.data());
+
+	// gl_DrawIDARB starts from 0 in every multi draw, at the first draw of its block
+	glBindVertexArray(buffer.vao);
+	for (int block = 0; block < block_count; ++block)
+	{
+		auto first_command = block * draws_per_block;
+		BindIndirectDrawData(buffer.draw_data_buffer, block_size * block, block_size);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+			reinterpret_cast<void*>(first_command * sizeof(DrawElementsIndirectCommand)),
+			glm::min(draws_per_block, command_count - first_command), 0);
+	}
+
+	buffer.instances.instances.clear();
+	buffer.commands.clear();
+	buffer.draw_data.clear();
+	return block_count;
+}
\ No newline at end of file
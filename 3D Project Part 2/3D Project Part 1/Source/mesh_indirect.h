@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "opengl_utilities.h"
+#include "mesh_instancing.h"
+
+/* Indirect Drawing Structs */
+
+// Same layout as the draw records of glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+// std140 element of the IndirectDraws block, how the draw's mesh decodes its positions.
+// The vertex shader finds it with gl_DrawIDARB.
+struct IndirectDrawData
+{
+	glm::vec4 position_scale;
+	glm::vec4 position_offset;
+};
+
+// A mesh in the shared buffers, its indices are relative to base_vertex
+struct IndirectMesh
+{
+	GLuint source_vao;
+	GLuint first_index;
+	GLsizei index_count;
+	GLint base_vertex;
+	glm::vec3 position_scale;
+	glm::vec3 position_offset;
+};
+
+// InterleavedQuantized meshes copied into one vertex and one index buffer, drawn through one VAO.
+// Every draw of a frame is a command of a single glMultiDrawElementsIndirect, their instances are
+// in one instance batch and every command starts at its own base instance. A draw of a mesh that
+// is not instanced is a draw of one instance with its model, color and textured.
+struct IndirectMeshBuffer
+{
+	GLuint vao;
+	GLuint vertex_buffer;
+	GLuint index_buffer;
+	GLuint command_buffer;
+	GLuint draw_data_buffer;
+
+	std::vector<IndirectMesh> meshes;
+	InstanceBatch instances;
+
+	// Draws of this frame
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<IndirectDrawData> draw_data;
+};
+
+/* Indirect Drawing Functions */
+
+// Needs GL 4.3 or ARB_multi_draw_indirect, with ARB_base_instance and ARB_shader_draw_parameters
+bool IndirectDrawsSupported();
+
+// Binds a block of zeroed draw data to the IndirectDraws binding point. A program that declares the block
+// needs a buffer there for all its draws, also when nothing is drawn indirectly. DrawIndirect binds its own.
+void BindEmptyIndirectDrawData();
+
+// Copies the buffers of the VAOs into the shared buffers, mesh i is vaos[i]. VAOs of other
+// layouts than InterleavedQuantized are left out and print a message.
+IndirectMeshBuffer CreateIndirectMeshBuffer(const std::vector<const VAO*>& vaos);
+
+// Index of the mesh copied from the VAO, -1 for none
+int FindIndirectMesh(const IndirectMeshBuffer& buffer, GLuint vao);
+
+// Adds instances for the draws of this frame, returns the base instance of the first
+int AddIndirectInstances(IndirectMeshBuffer& buffer, const std::vector<MeshInstance>& instances);
+
+// Adds a command that draws index_count indices of the mesh from its first_index, for
+// instance_count instances from base_instance. An index_count of -1 draws the whole mesh.
+void AddIndirectDraw(
+	IndirectMeshBuffer& buffer,
+	int mesh,
+	GLuint base_instance,
+	GLsizei instance_count,
+	GLuint first_index = 0,
+	GLsizei index_count = -1
+);
+
+// Uploads the draws of this frame, draws them with the program in use and clears them. The
+// commands are issued in a single glMultiDrawElementsIndirect per IndirectDraws block of draw
+// data. Returns the number of multi draws.
+int DrawIndirect(IndirectMeshBuffer& buffer);
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "mesh_instancing.h"
+
+#include <cstddef>
+
+/* Instancing Constants */
+
+// Locations after the terrain's instance attributes, a mat4 takes four
+static const GLuint instance_model_location = 5;
+static const GLuint instance_color_location = 9;
+static const GLuint instance_wobble_location = 10;
+static const GLuint instance_wobble_timing_location = 11;
+
+/* Instancing Functions */
+MeshInstance CreateMeshInstance(
+	const glm::mat4& model,
+	const glm::vec3& color,
+	bool textured,
+	const glm::vec3& wobble_axis,
+	float wobble_amplitude,
+	float wobble_frequency,
+	float wobble_phase
+)
+{
+	MeshInstance instance;
+	instance.model = model;
+	instance.color = color;
+	instance.textured = textured ? 1.f : 0.f;
+	instance.wobble_axis = glm::normalize(wobble_axis);
+	instance.wobble_amplitude = wobble_amplitude;
+	instance.wobble_frequency = wobble_frequency;
+	instance.wobble_phase = wobble_phase;
+	return instance;
+}
+
+InstanceBatch CreateInstanceBatch()
+{
+	InstanceBatch batch;
+	glGenBuffers(1, &batch.buffer);
+
+	// Draws that are not instanced still read the first instance of the VAOs the batch is attached to
+	glBindBuffer(GL_ARRAY_BUFFER, batch.buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(MeshInstance), nullptr, GL_STREAM_DRAW);
+	return batch;
+}
+
+void AttachInstanceBatch(const InstanceBatch& batch, GLuint vao, GLuint instance_divisor)
+{
+	auto stride = GLsizei(sizeof(MeshInstance));
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, batch.buffer);
+	for (GLuint column = 0; column < 4; ++column)
+	{
+		auto offset = offsetof(MeshInstance, model) + column * sizeof(glm::vec4);
+		glVertexAttribPointer(instance_model_location + column, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset));
+		glEnableVertexAttribArray(instance_model_location + column);
+	}
+	glVertexAttribPointer(instance_color_location, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(MeshInstance, color)));
+	glEnableVertexAttribArray(instance_color_location);
+	glVertexAttribPointer(instance_wobble_location, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(MeshInstance, wobble_axis)));
+	glEnableVertexAttribArray(instance_wobble_location);
+	glVertexAttribPointer(instance_wobble_timing_location, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(MeshInstance, wobble_frequency)));
+	glEnableVertexAttribArray(instance_wobble_timing_location);
+	SetInstanceDivisor(vao, instance_divisor);
+	glBindVertexArray(0);
+}
+
+void SetInstanceDivisor(GLuint vao, GLuint instance_divisor)
+{
+	glBindVertexArray(vao);
+	for (auto location = instance_model_location; location <= instance_wobble_timing_location; ++location)
+		glVertexAttribDivisor(location, instance_divisor);
+}
+
+void UploadInstanceBatch(const InstanceBatch& batch)
+{
+	// A new store every frame, so the driver does not wait for the draws of the last one
+	glBindBuffer(GL_ARRAY_BUFFER, batch.buffer);
+	glBufferData(GL_ARRAY_BUFFER, batch.instances.size() * sizeof(MeshInstance), batch.instances.data(), GL_STREAM_DRAW);
+}
\ No newline at end of file
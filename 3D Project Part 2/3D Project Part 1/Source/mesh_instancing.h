@@ -0,0 +1,56 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/* Instancing Structs */
+
+// Per instance attributes of an instanced draw, attributes 5 to 8 are the columns of model,
+// 9 is color and textured, 10 the wobble axis and amplitude and 11 its frequency and phase.
+// The shader rotates the mesh by amplitude * (cos(frequency * t + phase) + sin(frequency * t + phase))
+// radians around wobble_axis before model, t is u_time. An amplitude of 0 keeps it still.
+struct MeshInstance
+{
+	glm::mat4 model;
+	glm::vec3 color;
+	float textured;
+	glm::vec3 wobble_axis;
+	float wobble_amplitude;
+	float wobble_frequency;
+	float wobble_phase;
+};
+
+// Instances of one mesh drawn together, uploaded to buffer before every draw. The buffer is
+// attached to the VAOs the batch is drawn with, see AttachInstanceBatch.
+struct InstanceBatch
+{
+	GLuint buffer;
+	std::vector<MeshInstance> instances;
+};
+
+/* Instancing Functions */
+
+// The wobble axis does not need to be normalized
+MeshInstance CreateMeshInstance(
+	const glm::mat4& model,
+	const glm::vec3& color,
+	bool textured,
+	const glm::vec3& wobble_axis = glm::vec3(1, 0, 0),
+	float wobble_amplitude = 0,
+	float wobble_frequency = 0,
+	float wobble_phase = 0
+);
+
+InstanceBatch CreateInstanceBatch();
+
+// Points the instance attributes of the VAO to the batch's buffer, every instance_divisor
+// instances of a draw use the next MeshInstance
+void AttachInstanceBatch(const InstanceBatch& batch, GLuint vao, GLuint instance_divisor = 1);
+
+// Instances drawn for every MeshInstance, for draws that are instanced already. Binds the VAO.
+void SetInstanceDivisor(GLuint vao, GLuint instance_divisor);
+
+// Replaces the contents of the buffer with instances
+void UploadInstanceBatch(const InstanceBatch& batch);
\ No newline at end of file
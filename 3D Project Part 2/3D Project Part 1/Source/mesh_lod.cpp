@@ -0,0 +1,464 @@
+#include "mesh_lod.h"
+
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "mesh_cache.h"
+#include "mesh_streaming.h"
+#include "mesh_compute.h"
+#include "mesh_simplification.h"
+
+/* Helper Functions */
+
+// Chord deviation along the profile, measured at the middle of each segment between the
+// profile parameters, plus the chord deviation of the widest ring around the rotation
+static float RevolutionError(ParametricLineBatch parametric_line, const std::vector<double>& profile_t, int rotation_segments)
+{
+	int sample_count = 2 * int(profile_t.size()) - 1;
+
+	// Odd samples are the middle of the segment between their neighbours
+	std::vector<double> t(sample_count);
+	for (int i = 0; i < sample_count; ++i)
+		t[i] = i % 2 == 0 ? profile_t[i / 2] : (profile_t[i / 2] + profile_t[i / 2 + 1]) / 2;
+
+	std::vector<double> x(sample_count), y(sample_count);
+	std::vector<double> tangent_x(sample_count), tangent_y(sample_count);
+	parametric_line(t.data(), sample_count, x.data(), y.data(), tangent_x.data(), tangent_y.data());
+
+	double profile_error = 0;
+	double max_radius = 0;
+	for (int i = 0; i < sample_count; ++i)
+	{
+		max_radius = glm::max(max_radius, glm::abs(x[i]));
+
+		if (i % 2 == 1)
+		{
+			auto chord_middle = (glm::dvec2(x[i - 1], y[i - 1]) + glm::dvec2(x[i + 1], y[i + 1])) / 2.;
+			profile_error = glm::max(profile_error, glm::length(glm::dvec2(x[i], y[i]) - chord_middle));
+		}
+	}
+
+	auto rotation_error = max_radius * (1 - cos(glm::pi<double>() / (rotation_segments - 1)));
+	return float(profile_error + rotation_error);
+}
+
+static float RevolutionError(ParametricLineBatch parametric_line, int vertical_segments, int rotation_segments)
+{
+	std::vector<double> profile_t(vertical_segments);
+	for (int v = 0; v < vertical_segments; ++v)
+		profile_t[v] = v / double(vertical_segments - 1);
+	return RevolutionError(parametric_line, profile_t, rotation_segments);
+}
+
+// Largest distance between points spread over the triangles and the profile polyline, which
+// is revolved around the Y axis. Points are compared in the plane of the profile, at their
+// distance from the axis and their height.
+static float RevolutionSurfaceDistance(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<GLuint>& indices,
+	const std::vector<glm::dvec2>& profile
+)
+{
+	// Barycentric grid of 15 points per triangle, its corners, edges and inside
+	const int grid_segments = 4;
+
+	double max_distance = 0;
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		glm::dvec3 corners[3] = { positions[indices[t]], positions[indices[t + 1]], positions[indices[t + 2]] };
+		for (int i = 0; i <= grid_segments; ++i)
+			for (int j = 0; i + j <= grid_segments; ++j)
+			{
+				auto point = (corners[0] * double(i) + corners[1] * double(j) + corners[2] * double(grid_segments - i - j)) / double(grid_segments);
+				auto planar = glm::dvec2(glm::length(glm::dvec2(point.x, point.z)), point.y);
+
+				auto distance = std::numeric_limits<double>::max();
+				for (size_t v = 0; v + 1 < profile.size(); ++v)
+				{
+					auto segment = profile[v + 1] - profile[v];
+					auto length_squared = glm::dot(segment, segment);
+					auto along = length_squared > 0 ? glm::clamp(glm::dot(planar - profile[v], segment) / length_squared, 0., 1.) : 0.;
+					distance = glm::min(distance, glm::length(planar - (profile[v] + segment * along)));
+				}
+				max_distance = glm::max(max_distance, distance);
+			}
+	}
+	return float(max_distance);
+}
+
+// Largest distance between a triangle's plane and the unit sphere, for meshes of well shaped
+// triangles whose closest point to the center lies inside the triangle
+static float SphereTessellationError(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& indices)
+{
+	float error = 0;
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		auto& a = positions[indices[t]];
+		auto normal = glm::normalize(glm::cross(positions[indices[t + 1]] - a, positions[indices[t + 2]] - a));
+		error = glm::max(error, 1 - glm::abs(glm::dot(normal, a)));
+	}
+	return error;
+}
+
+static std::string LayoutName(VertexLayout layout)
+{
+	return layout == VertexLayout::Separate ? "separate" : "quantized";
+}
+
+// Adds the level stored under cache_key to the end of the chain. On a cache miss
+// generate(positions, normals, uvs, indices) creates the mesh and returns its
+// geometric error, the mesh is then optimized and written to the cache.
+template <typename Generate>
+static void AddLODLevel(
+	LODChain& chain,
+	const std::string& cache_key,
+	VertexLayout layout,
+	int vertical_segments,
+	int rotation_segments,
+	Generate generate
+)
+{
+	MappedMesh mapped_mesh;
+	if (!cache_key.empty() && MapCachedMesh(cache_key, mapped_mesh))
+	{
+		auto& header = mapped_mesh.header;
+		chain.bounding_radius = glm::max(chain.bounding_radius, header.bounding_radius);
+		chain.levels.push_back(LODLevel{
+			VAO(mapped_mesh.data),
+			vertical_segments,
+			rotation_segments,
+			header.geometric_error,
+			header.optimization_report,
+			header.topology_statistics,
+			std::vector<MeshPatch>(mapped_mesh.patches, mapped_mesh.patches + header.patch_count)
+		});
+
+		// glBufferData has copied the data, the mapping is not needed anymore
+		UnmapCachedMesh(mapped_mesh);
+		return;
+	}
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	std::vector<GLuint> indices;
+	auto geometric_error = generate(positions, normals, uvs, indices);
+
+	MeshCacheHeader header = {};
+	for (auto& position : positions)
+		header.bounding_radius = glm::max(header.bounding_radius, glm::length(position));
+	header.geometric_error = geometric_error;
+	header.optimization_report = OptimizeMesh(positions, normals, uvs, indices);
+	header.topology_statistics = AnalyzeTopology(positions, indices);
+
+	// Patches keep the optimized triangle order inside them, the vertices are reordered for the new order
+	auto patches = PartitionMeshPatches(positions, normals, indices);
+	OptimizeVertexFetch(positions, normals, uvs, indices);
+	header.optimization_report.after = AnalyzeVertexCache(indices, positions.size());
+
+	VertexData data = {};
+	data.layout = layout;
+	data.vertex_count = GLsizei(positions.size());
+	data.index_count = GLsizei(indices.size());
+	data.indices = indices.data();
+
+	std::vector<QuantizedVertex> quantized_vertices;
+	if (layout == VertexLayout::Separate)
+	{
+		data.positions = positions.data();
+		data.normals = normals.data();
+		data.uvs = uvs.data();
+	}
+	else
+	{
+		quantized_vertices = QuantizeVertices(positions, normals, uvs, data.position_scale, data.position_offset);
+		data.quantized_vertices = quantized_vertices.data();
+	}
+
+	if (!cache_key.empty())
+		WriteCachedMesh(cache_key, header, data, patches);
+
+	chain.bounding_radius = glm::max(chain.bounding_radius, header.bounding_radius);
+	chain.levels.push_back(LODLevel{
+		VAO(data),
+		vertical_segments,
+		rotation_segments,
+		geometric_error,
+		header.optimization_report,
+		header.topology_statistics,
+		patches
+	});
+}
+
+// Cache key of a level of a surface of revolution, empty without a cache_name
+static std::string RevolutionCacheKey(
+	const char* cache_name,
+	const std::string& sampling,
+	RevolutionTopology topology,
+	VertexLayout layout
+)
+{
+	if (cache_name == nullptr)
+		return std::string();
+	return std::string(cache_name) + "_" + sampling
+		+ (topology.collapse_poles ? "_poles" : "") + (topology.weld_seam ? "_welded" : "") + "_" + LayoutName(layout);
+}
+
+// Samplings with the same segment counts can still place them differently, so the key has the error
+static std::string AdaptiveSamplingKey(AdaptiveSampling sampling)
+{
+	std::ostringstream key;
+	key << "adaptive_" << sampling.max_error << "_" << sampling.initial_segments << "_" << sampling.max_depth;
+	return key.str();
+}
+
+// Writes the level straight into its buffers, by compute shaders when they are enabled and know the parametric function
+static void AddStreamedLODLevel(
+	LODChain& chain,
+	ParametricLineBatch parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	VertexLayout layout,
+	RevolutionTopology topology
+)
+{
+	MeshStreamingReport streaming_report = {};
+	auto vao = ComputeGenerationEnabled()
+		? ComputeParametricShapeFrom2D(
+			parametric_line, vertical_segments, rotation_segments, layout, topology, &streaming_report.bounding_radius)
+		: StreamParametricShapeFrom2D(
+			parametric_line, vertical_segments, rotation_segments, layout, topology, 1 << 20, &streaming_report);
+
+	// Only a mesh the compute shaders built, they are off again when they did not build
+	if (ComputeGenerationEnabled() && ParametricLineSource(parametric_line) != nullptr && ComputeValidationEnabled())
+	{
+		auto validation = ValidateComputeShapeFrom2D(vao, parametric_line, vertical_segments, rotation_segments, topology);
+		std::cout << "Compute mesh " << vertical_segments << "x" << rotation_segments
+			<< (validation.passed ? " matches" : " does not match") << " the CPU mesh, position error: " << validation.max_position_error
+			<< " normal error: " << validation.max_normal_error << " uv error: " << validation.max_uv_error
+			<< " mismatched indices: " << validation.mismatched_indices << std::endl;
+	}
+
+	chain.bounding_radius = glm::max(chain.bounding_radius, streaming_report.bounding_radius);
+	chain.levels.push_back(LODLevel{
+		vao,
+		vertical_segments,
+		rotation_segments,
+		RevolutionError(parametric_line, vertical_segments, rotation_segments),
+		MeshOptimizationReport(),
+		TopologyStatistics(),
+		std::vector<MeshPatch>()
+	});
+}
+
+/* Mesh LOD Functions */
+LODChain GenerateLODChain(
+	ParametricLineBatch parametric_line,
+	AdaptiveSampling sampling,
+	int level_count,
+	VertexLayout layout,
+	RevolutionTopology topology,
+	const char* cache_name
+)
+{
+	LODChain chain;
+	chain.bounding_radius = 0;
+	chain.levels.reserve(level_count);
+
+	for (int level = 0; level < level_count; ++level)
+	{
+		// Chord deviations grow with the square of the segment length, so half the segments is four times the error
+		auto level_sampling = sampling;
+		level_sampling.max_error = sampling.max_error * double(1 << (2 * level));
+
+		int level_rotation_segments;
+		auto profile_t = AdaptiveRevolutionParameters(parametric_line, level_sampling, level_rotation_segments);
+		auto level_vertical_segments = int(profile_t.size());
+
+		auto cache_key = RevolutionCacheKey(cache_name, AdaptiveSamplingKey(level_sampling), topology, layout);
+
+		// Streaming only writes evenly spaced profiles, so without the cache the level gets its segment counts spread evenly
+		if (cache_key.empty() || !MeshCacheEnabled())
+		{
+			AddStreamedLODLevel(chain, parametric_line, level_vertical_segments, level_rotation_segments, layout, topology);
+			continue;
+		}
+
+		AddLODLevel(chain, cache_key, layout, level_vertical_segments, level_rotation_segments,
+			[&](std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& uvs, std::vector<GLuint>& indices)
+		{
+			GenerateParametricShapeFrom2D(positions, normals, uvs, indices, parametric_line, level_sampling, topology);
+			return RevolutionError(parametric_line, profile_t, level_rotation_segments);
+		});
+	}
+
+	return chain;
+}
+
+LODChain GenerateSimplifiedLODChain(
+	ParametricLineBatch parametric_line,
+	AdaptiveSampling sampling,
+	int level_count,
+	VertexLayout layout,
+	RevolutionTopology topology,
+	const char* cache_name
+)
+{
+	LODChain chain;
+	chain.bounding_radius = 0;
+	chain.levels.reserve(level_count);
+
+	int rotation_segments;
+	auto profile_t = AdaptiveRevolutionParameters(parametric_line, sampling, rotation_segments);
+	auto sampling_key = AdaptiveSamplingKey(sampling);
+
+	// The mesh of the last level simplified so far, made on the first cache miss and kept for the levels after it
+	std::vector<glm::vec3> source_positions;
+	std::vector<glm::vec3> source_normals;
+	std::vector<glm::vec2> source_uvs;
+	std::vector<GLuint> source_indices;
+	int source_level = -1;
+
+	// Profile of the finest level, around the axis, and how far that level is from the parametric surface
+	std::vector<glm::dvec2> profile;
+	float source_error = 0;
+
+	// Triangles level k aims for, a quarter of the level before, like half the segments both ways
+	auto TargetTriangleCount = [&](int level)
+	{
+		return size_t(chain.levels[0].vao.element_array_count / 3) >> (2 * level);
+	};
+
+	for (int level = 0; level < level_count; ++level)
+	{
+		// The finest level is the same mesh as the first level of the adaptive chain
+		auto cache_key = RevolutionCacheKey(cache_name,
+			level == 0 ? sampling_key : sampling_key + "_simplified_" + std::to_string(level), topology, layout);
+
+		AddLODLevel(chain, cache_key, layout, level == 0 ? int(profile_t.size()) : 0, level == 0 ? rotation_segments : 0,
+			[&](std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& uvs, std::vector<GLuint>& indices)
+		{
+			if (source_level < 0)
+			{
+				GenerateParametricShapeFrom2D(
+					source_positions, source_normals, source_uvs, source_indices, parametric_line, sampling, topology);
+				source_error = RevolutionError(parametric_line, profile_t, rotation_segments);
+				source_level = 0;
+
+				auto count = int(profile_t.size());
+				std::vector<double> x(count), y(count), tangent_x(count), tangent_y(count);
+				parametric_line(profile_t.data(), count, x.data(), y.data(), tangent_x.data(), tangent_y.data());
+				for (int v = 0; v < count; ++v)
+					profile.push_back(glm::dvec2(glm::abs(x[v]), y[v]));
+			}
+
+			// Collapses stay within the error the adaptive chain has on the level
+			while (source_level < level)
+			{
+				++source_level;
+				SimplifyMesh(source_positions, source_normals, source_uvs, source_indices,
+					TargetTriangleCount(source_level), float(sampling.max_error * double(1 << (2 * source_level))));
+			}
+
+			positions = source_positions;
+			normals = source_normals;
+			uvs = source_uvs;
+			indices = source_indices;
+
+			// The quadric error of the simplification is a mean, so the distance is measured, plus the
+			// distance of the finest profile from the parametric one
+			return level == 0 ? source_error : RevolutionSurfaceDistance(source_positions, source_indices, profile) + source_error;
+		});
+
+		// Locked vertices, e.g. at the poles, can keep a level well above its target, the levels after it would not get coarser
+		if (level > 0 && size_t(chain.levels[level].vao.element_array_count / 3) > 2 * TargetTriangleCount(level))
+			break;
+	}
+
+	return chain;
+}
+
+LODChain GenerateIcosphereLODChain(int subdivisions, int level_count, VertexLayout layout)
+{
+	LODChain chain;
+	chain.bounding_radius = 0;
+	chain.levels.reserve(level_count);
+
+	for (int level = 0; level < level_count; ++level)
+	{
+		auto level_subdivisions = glm::max(subdivisions - level, 0);
+		auto cache_key = "icosphere_" + std::to_string(level_subdivisions) + "_" + LayoutName(layout);
+
+		AddLODLevel(chain, cache_key, layout, 0, 0,
+			[&](std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& uvs, std::vector<GLuint>& indices)
+		{
+			GenerateIcosphere(positions, normals, uvs, indices, level_subdivisions);
+			return SphereTessellationError(positions, indices);
+		});
+	}
+
+	return chain;
+}
+
+LODChain GenerateCubeSphereLODChain(int face_segments, int level_count, VertexLayout layout)
+{
+	LODChain chain;
+	chain.bounding_radius = 0;
+	chain.levels.reserve(level_count);
+
+	for (int level = 0; level < level_count; ++level)
+	{
+		auto level_face_segments = glm::max(face_segments >> level, 2);
+		auto cache_key = "cube_sphere_" + std::to_string(level_face_segments) + "_" + LayoutName(layout);
+
+		AddLODLevel(chain, cache_key, layout, 0, 0,
+			[&](std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& uvs, std::vector<GLuint>& indices)
+		{
+			GenerateCubeSphere(positions, normals, uvs, indices, level_face_segments);
+			return SphereTessellationError(positions, indices);
+		});
+	}
+
+	return chain;
+}
+
+float ProjectedDiameter(
+	const LODChain& chain,
+	const glm::mat4& model,
+	const glm::vec3& camera_position,
+	float vertical_fov,
+	int screen_height
+)
+{
+	auto center = glm::vec3(model * glm::vec4(0, 0, 0, 1));
+	auto scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	auto radius = chain.bounding_radius * scale;
+
+	auto distance = glm::length(center - camera_position);
+	if (distance <= radius)
+		return std::numeric_limits<float>::max();
+
+	return radius / (distance * glm::tan(vertical_fov / 2)) * screen_height;
+}
+
+int SelectLOD(const LODChain& chain, float projected_diameter, int previous_level, float max_pixel_error)
+{
+	// Coarser levels need to be this far under the limit before a draw switches to them
+	const float hysteresis = 0.75f;
+
+	auto pixels_per_unit = projected_diameter / (2 * chain.bounding_radius);
+	auto CoarsestLevelWithin = [&](float pixel_error)
+	{
+		int level = 0;
+		while (level + 1 < int(chain.levels.size()) && chain.levels[level + 1].geometric_error * pixels_per_unit <= pixel_error)
+			++level;
+		return level;
+	};
+
+	auto required_level = CoarsestLevelWithin(max_pixel_error);
+	if (previous_level < 0 || previous_level > required_level)
+		return required_level;
+
+	return glm::max(previous_level, CoarsestLevelWithin(max_pixel_error * hysteresis));
+}
\ No newline at end of file
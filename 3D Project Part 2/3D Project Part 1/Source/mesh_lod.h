@@ -0,0 +1,91 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "opengl_utilities.h"
+#include "mesh_generation.h"
+#include "mesh_optimization.h"
+#include "mesh_culling.h"
+
+/* Mesh LOD Structs */
+
+struct LODLevel
+{
+	VAO vao;
+
+	// Segments of the surface of revolution, 0 for the sphere generators and simplified levels
+	int vertical_segments;
+	int rotation_segments;
+
+	// Largest distance between the tessellation and the parametric surface, in mesh space
+	float geometric_error;
+
+	// Zero for levels that were streamed instead of generated on the CPU, see GenerateLODChain
+	MeshOptimizationReport optimization_report;
+	TopologyStatistics topology_statistics;
+
+	// Cover the whole index buffer, empty for streamed levels, which are drawn in one piece
+	std::vector<MeshPatch> patches;
+};
+
+// levels[0] is the most detailed level, every next level has about half the segments
+struct LODChain
+{
+	std::vector<LODLevel> levels;
+
+	// Bounding sphere around the mesh space origin
+	float bounding_radius;
+};
+
+/* Mesh LOD Functions */
+
+// Every level is generated by the AdaptiveSampling overload of GenerateParametricShapeFrom2D with four
+// times the max_error of the one before, its segment counts follow from that error. Levels are loaded
+// from the mesh cache when it has them, and written to it otherwise. cache_name identifies the
+// parametric function, the chain is not cached without it. Levels that are not cached are streamed
+// into their buffers with the same segment counts spread evenly, see StreamParametricShapeFrom2D.
+LODChain GenerateLODChain(
+	ParametricLineBatch parametric_line,
+	AdaptiveSampling sampling,
+	int level_count,
+	VertexLayout layout,
+	RevolutionTopology topology = RevolutionTopology(),
+	const char* cache_name = nullptr
+);
+
+// The finest level of the AdaptiveSampling chain above, every next level simplified from the one before it
+// to a quarter of the triangles, see SimplifyMesh. The chain ends early when the simplification stalls far
+// above that, e.g. on the locked pole vertices of a textured mesh. Levels are cached like above, but never
+// streamed, the simplification needs the mesh on the CPU.
+LODChain GenerateSimplifiedLODChain(
+	ParametricLineBatch parametric_line,
+	AdaptiveSampling sampling,
+	int level_count,
+	VertexLayout layout,
+	RevolutionTopology topology = RevolutionTopology(),
+	const char* cache_name = nullptr
+);
+
+// Levels of GenerateIcosphere, from subdivisions down by one subdivision per level
+LODChain GenerateIcosphereLODChain(int subdivisions, int level_count, VertexLayout layout);
+
+// Levels of GenerateCubeSphere, from face_segments down by half the segments per level
+LODChain GenerateCubeSphereLODChain(int face_segments, int level_count, VertexLayout layout);
+
+// Diameter in pixels of the chain's bounding sphere after the model transform
+float ProjectedDiameter(
+	const LODChain& chain,
+	const glm::mat4& model,
+	const glm::vec3& camera_position,
+	float vertical_fov,
+	int screen_height
+);
+
+// Picks the coarsest level whose geometric error stays under max_pixel_error on screen.
+// previous_level is the level picked for the same draw in the last frame, or -1. A draw
+// only switches to a coarser level once it is well under the limit, so it does not flicker
+// between two levels around the threshold.
+int SelectLOD(const LODChain& chain, float projected_diameter, int previous_level, float max_pixel_error = 0.5f);
\ No newline at end of file
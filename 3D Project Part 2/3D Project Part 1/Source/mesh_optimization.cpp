@@ -0,0 +1,290 @@
+#include "mesh_optimization.h"
+
+#include <algorithm>
+#include "GLM/gtc/type_precision.hpp"
+
+/* Mesh Optimization Functions */
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<GLuint>& indices, size_t vertex_count, int cache_size)
+{
+	// A vertex is in the FIFO cache if it was inserted less than cache_size misses ago
+	std::vector<size_t> inserted_at(vertex_count, 0);
+	size_t misses = 0;
+	size_t unique_vertices = 0;
+
+	for (auto index : indices)
+	{
+		if (inserted_at[index] == 0)
+			++unique_vertices;
+
+		if (inserted_at[index] == 0 || misses + 1 - inserted_at[index] > size_t(cache_size))
+		{
+			++misses;
+			inserted_at[index] = misses;
+		}
+	}
+
+	VertexCacheStatistics statistics;
+	statistics.acmr = indices.empty() ? 0 : misses / double(indices.size() / 3);
+	statistics.atvr = unique_vertices == 0 ? 0 : misses / double(unique_vertices);
+	return statistics;
+}
+
+std::vector<GLuint> PositionRemap(const std::vector<glm::vec3>& positions, float relative_tolerance)
+{
+	std::vector<GLuint> remap(positions.size());
+	if (positions.empty())
+		return remap;
+
+	auto minimum = positions[0];
+	auto maximum = positions[0];
+	for (auto& position : positions)
+	{
+		minimum = glm::min(minimum, position);
+		maximum = glm::max(maximum, position);
+	}
+
+	// Positions are snapped to a grid of the tolerance, and sorted so equal cells are next to each other
+	auto cell_size = glm::max(glm::max(maximum.x - minimum.x, maximum.y - minimum.y), maximum.z - minimum.z) * relative_tolerance;
+	if (cell_size <= 0)
+		cell_size = 1;
+
+	std::vector<glm::i64vec3> cells(positions.size());
+	for (size_t v = 0; v < positions.size(); ++v)
+		cells[v] = glm::i64vec3(glm::round((positions[v] - minimum) / cell_size));
+
+	auto CellLess = [&](GLuint a, GLuint b)
+	{
+		if (cells[a].x != cells[b].x)
+			return cells[a].x < cells[b].x;
+		if (cells[a].y != cells[b].y)
+			return cells[a].y < cells[b].y;
+		if (cells[a].z != cells[b].z)
+			return cells[a].z < cells[b].z;
+		return a < b;
+	};
+
+	std::vector<GLuint> order(positions.size());
+	for (size_t v = 0; v < order.size(); ++v)
+		order[v] = GLuint(v);
+	std::sort(order.begin(), order.end(), CellLess);
+
+	// Vertices in the same cell map to the first one
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		if (i > 0 && cells[order[i]] == cells[order[i - 1]])
+			remap[order[i]] = remap[order[i - 1]];
+		else
+			remap[order[i]] = order[i];
+	}
+
+	return remap;
+}
+
+TopologyStatistics AnalyzeTopology(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<GLuint>& indices,
+	float relative_tolerance
+)
+{
+	TopologyStatistics statistics;
+	statistics.duplicate_vertices = 0;
+	statistics.degenerate_triangles = 0;
+
+	auto remap = PositionRemap(positions, relative_tolerance);
+	for (size_t v = 0; v < remap.size(); ++v)
+		if (remap[v] != v)
+			++statistics.duplicate_vertices;
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		auto a = remap[indices[t]];
+		auto b = remap[indices[t + 1]];
+		auto c = remap[indices[t + 2]];
+		if (a == b || b == c || a == c)
+			++statistics.degenerate_triangles;
+	}
+
+	return statistics;
+}
+
+void OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertex_count)
+{
+	const int cache_size = 32;
+	size_t triangle_count = indices.size() / 3;
+
+	// Scores are looked up from tables, since they are recomputed for every cache entry after every triangle
+	const int max_valence = 32;
+	float cache_position_scores[cache_size];
+	float valence_scores[max_valence];
+	for (int i = 0; i < cache_size; ++i)
+		// The last triangle's vertices get a fixed score, so its neighbours are not favoured over each other
+		cache_position_scores[i] = i < 3 ? 0.75f : glm::pow(1 - (i - 3) / float(cache_size - 3), 1.5f);
+	for (int i = 0; i < max_valence; ++i)
+		// Vertices with few triangles left are finished first, so they can leave the cache
+		valence_scores[i] = i == 0 ? 0 : 2 * glm::pow(float(i), -0.5f);
+
+	auto VertexScore = [&](int cache_position, int remaining_triangles)
+	{
+		if (remaining_triangles == 0)
+			return -1.f;
+
+		auto score = cache_position < 0 ? 0 : cache_position_scores[cache_position];
+		return score + valence_scores[glm::min(remaining_triangles, max_valence - 1)];
+	};
+
+	// Triangles using each vertex, the ones not emitted yet for vertex v are
+	// vertex_triangles[triangle_offsets[v], triangle_offsets[v] + remaining_triangles[v])
+	std::vector<GLuint> triangle_offsets(vertex_count + 1, 0);
+	for (auto index : indices)
+		++triangle_offsets[index + 1];
+	for (size_t v = 0; v < vertex_count; ++v)
+		triangle_offsets[v + 1] += triangle_offsets[v];
+
+	std::vector<GLuint> vertex_triangles(indices.size());
+	std::vector<GLuint> fill_offsets(triangle_offsets.begin(), triangle_offsets.end() - 1);
+	for (size_t t = 0; t < triangle_count; ++t)
+		for (int k = 0; k < 3; ++k)
+			vertex_triangles[fill_offsets[indices[t * 3 + k]]++] = GLuint(t);
+
+	std::vector<int> remaining_triangles(vertex_count);
+	std::vector<int> cache_positions(vertex_count, -1);
+	std::vector<float> vertex_scores(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		remaining_triangles[v] = int(triangle_offsets[v + 1] - triangle_offsets[v]);
+		vertex_scores[v] = VertexScore(-1, remaining_triangles[v]);
+	}
+
+	std::vector<float> triangle_scores(triangle_count);
+	for (size_t t = 0; t < triangle_count; ++t)
+		triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+
+	std::vector<char> emitted(triangle_count, false);
+	std::vector<GLuint> optimized;
+	optimized.reserve(indices.size());
+
+	// LRU cache, cache_size entries plus room for the vertices of the emitted triangle
+	std::vector<GLuint> cache, next_cache;
+	cache.reserve(cache_size + 3);
+	next_cache.reserve(cache_size + 3);
+
+	// Fallback for when no triangle around the cache is left, triangles before it are all emitted
+	size_t next_unemitted = 0;
+	long long best_triangle = -1;
+
+	while (optimized.size() < indices.size())
+	{
+		if (best_triangle < 0)
+		{
+			while (emitted[next_unemitted])
+				++next_unemitted;
+			best_triangle = (long long)next_unemitted;
+		}
+
+		const GLuint* triangle = &indices[size_t(best_triangle) * 3];
+		emitted[size_t(best_triangle)] = true;
+		optimized.insert(optimized.end(), triangle, triangle + 3);
+
+		next_cache.assign(triangle, triangle + 3);
+		for (auto vertex : cache)
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				next_cache.push_back(vertex);
+
+		// Move the emitted triangle past the remaining ones of its vertices
+		for (int k = 0; k < 3; ++k)
+		{
+			auto vertex_begin = &vertex_triangles[triangle_offsets[triangle[k]]];
+			auto vertex_end = vertex_begin + remaining_triangles[triangle[k]];
+			std::swap(*std::find(vertex_begin, vertex_end, GLuint(best_triangle)), *(vertex_end - 1));
+			--remaining_triangles[triangle[k]];
+		}
+
+		// Update the vertex scores, and the scores of the triangles around them by the difference
+		for (int i = 0; i < int(next_cache.size()); ++i)
+		{
+			auto vertex = next_cache[i];
+			cache_positions[vertex] = i < cache_size ? i : -1;
+
+			auto score = VertexScore(cache_positions[vertex], remaining_triangles[vertex]);
+			auto difference = score - vertex_scores[vertex];
+			vertex_scores[vertex] = score;
+
+			for (int j = 0; j < remaining_triangles[vertex]; ++j)
+				triangle_scores[vertex_triangles[triangle_offsets[vertex] + j]] += difference;
+		}
+
+		if (next_cache.size() > size_t(cache_size))
+			next_cache.resize(cache_size);
+		std::swap(cache, next_cache);
+
+		best_triangle = -1;
+		float best_score = -1;
+		for (auto vertex : cache)
+			for (int j = 0; j < remaining_triangles[vertex]; ++j)
+			{
+				auto t = vertex_triangles[triangle_offsets[vertex] + j];
+				if (triangle_scores[t] > best_score)
+				{
+					best_score = triangle_scores[t];
+					best_triangle = t;
+				}
+			}
+	}
+
+	indices.swap(optimized);
+}
+
+void OptimizeVertexFetch(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices
+)
+{
+	const GLuint unassigned = ~0u;
+
+	std::vector<GLuint> remap(positions.size(), unassigned);
+	GLuint next_vertex = 0;
+	for (auto& index : indices)
+	{
+		if (remap[index] == unassigned)
+			remap[index] = next_vertex++;
+		index = remap[index];
+	}
+
+	// Vertices that no triangle uses are kept at the end
+	for (auto& new_vertex : remap)
+		if (new_vertex == unassigned)
+			new_vertex = next_vertex++;
+
+	std::vector<glm::vec3> new_positions(positions.size());
+	std::vector<glm::vec3> new_normals(normals.size());
+	std::vector<glm::vec2> new_uvs(uvs.size());
+	for (size_t v = 0; v < positions.size(); ++v)
+	{
+		new_positions[remap[v]] = positions[v];
+		new_normals[remap[v]] = normals[v];
+		new_uvs[remap[v]] = uvs[v];
+	}
+
+	positions.swap(new_positions);
+	normals.swap(new_normals);
+	uvs.swap(new_uvs);
+}
+
+MeshOptimizationReport OptimizeMesh(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices
+)
+{
+	MeshOptimizationReport report;
+	report.before = AnalyzeVertexCache(indices, positions.size());
+
+	OptimizeVertexCache(indices, positions.size());
+	OptimizeVertexFetch(positions, normals, uvs, indices);
+
+	report.after = AnalyzeVertexCache(indices, positions.size());
+	return report;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/* Mesh Optimization Structs */
+
+// ACMR: transformed vertices per triangle, ATVR: transformed vertices per unique vertex.
+// Both are measured on a simulated FIFO post-transform cache, lower is better.
+struct VertexCacheStatistics
+{
+	double acmr;
+	double atvr;
+};
+
+// Vertices at the same position as an earlier one, and triangles with two corners at the same position
+struct TopologyStatistics
+{
+	size_t duplicate_vertices;
+	size_t degenerate_triangles;
+};
+
+struct MeshOptimizationReport
+{
+	VertexCacheStatistics before;
+	VertexCacheStatistics after;
+};
+
+/* Mesh Optimization Functions */
+
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<GLuint>& indices, size_t vertex_count, int cache_size = 16);
+
+// For every vertex the first vertex at the same position. Positions closer than
+// relative_tolerance times the size of the mesh are considered the same.
+std::vector<GLuint> PositionRemap(const std::vector<glm::vec3>& positions, float relative_tolerance = 1e-6f);
+
+// Positions closer than relative_tolerance times the size of the mesh are considered the same
+TopologyStatistics AnalyzeTopology(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<GLuint>& indices,
+	float relative_tolerance = 1e-6f
+);
+
+// Reorders triangles for post-transform cache locality (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertex_count);
+
+// Reorders vertices by first use in the index buffer and remaps the indices
+void OptimizeVertexFetch(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices
+);
+
+// Runs both passes above, to be used on the generator output before creating the VAO
+MeshOptimizationReport OptimizeMesh(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices
+);
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "mesh_procedural.h"
+
+#include <limits>
+#include "GLM/gtc/constants.hpp"
+
+/* Procedural Mesh Constants */
+
+// Beyond this the vertices are closer than a pixel even on a full screen mesh
+static const int max_procedural_segments = 2048;
+
+/* Procedural Mesh Functions */
+ProceduralProfile ProceduralHalfCircle()
+{
+	return ProceduralProfile{ glm::vec2(0, 0), 1.f, glm::pi<float>() };
+}
+
+ProceduralProfile ProceduralCircle()
+{
+	return ProceduralProfile{ glm::vec2(0.7f, 0), 0.3f, glm::two_pi<float>() };
+}
+
+ProceduralMesh CreateProceduralMesh(const ProceduralProfile& profile)
+{
+	ProceduralMesh mesh;
+	mesh.profile = profile;
+
+	// Exact when the arc passes the point farthest from the origin, which both profiles above do
+	mesh.bounding_radius = glm::length(profile.center) + profile.radius;
+
+	glGenVertexArrays(1, &mesh.vao);
+	return mesh;
+}
+
+glm::ivec2 ProceduralSegments(const ProceduralMesh& mesh, float projected_diameter, float max_pixel_error)
+{
+	auto& profile = mesh.profile;
+	auto max_radius = glm::abs(profile.center.x) + profile.radius;
+
+	// Half of the error is given to the profile and half to the rotation
+	auto max_error = max_pixel_error * 2 * mesh.bounding_radius / glm::max(projected_diameter, std::numeric_limits<float>::min()) / 2;
+
+	// A segment of angle a deviates from its arc of radius radius by radius * (1 - cos(a / 2))
+	auto SegmentsForArc = [&](float radius, float arc_angle)
+	{
+		if (max_error >= radius)
+			return 1;
+		return int(glm::min(glm::ceil(arc_angle / (2 * glm::acos(1 - max_error / radius))), float(max_procedural_segments)));
+	};
+
+	auto vertical_segments = glm::max(SegmentsForArc(profile.radius, profile.arc_angle), 2) + 1;
+	auto rotation_segments = glm::max(SegmentsForArc(max_radius, glm::two_pi<float>()), 3) + 1;
+	return glm::ivec2(vertical_segments, rotation_segments);
+}
+
+void DrawProceduralMesh(const ProceduralMesh& mesh, const glm::ivec2& segments, int mesh_instance_count)
+{
+	// Each strip starts with its first vertex twice, which keeps the winding of GenerateParametricShapeFrom2D
+	glBindVertexArray(mesh.vao);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * segments.x + 1, (segments.y - 1) * mesh_instance_count);
+}
+
+int ProceduralTriangleCount(const glm::ivec2& segments)
+{
+	return 2 * (segments.x - 1) * (segments.y - 1);
+}
\ No newline at end of file
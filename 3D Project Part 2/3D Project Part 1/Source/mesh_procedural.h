@@ -0,0 +1,47 @@
+#pragma once
+
+#include <iostream>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/* Procedural Mesh Structs */
+
+// Circular arc that the vertex shader can evaluate, t in [0, 1] maps to the point at angle
+// (t - 0.5) * arc_angle around center. The surface is the arc rotated around the y axis.
+struct ProceduralProfile
+{
+	glm::vec2 center;
+	float radius;
+	float arc_angle;
+};
+
+// A surface of revolution without vertex or index buffers. The vertex shader rebuilds
+// every vertex from gl_VertexID and gl_InstanceID, so the tessellation can change per
+// draw. vao has no vertex attributes, core profile only needs one to be bound for drawing.
+struct ProceduralMesh
+{
+	GLuint vao;
+	ProceduralProfile profile;
+
+	// Bounding sphere around the mesh space origin
+	float bounding_radius;
+};
+
+/* Procedural Mesh Functions */
+
+// Same curves as ParametricHalfCircle and ParametricCircle
+ProceduralProfile ProceduralHalfCircle();
+ProceduralProfile ProceduralCircle();
+
+ProceduralMesh CreateProceduralMesh(const ProceduralProfile& profile);
+
+// Fewest (vertical, rotation) segments whose geometric error stays under max_pixel_error
+// when the mesh covers projected_diameter pixels, see ProjectedDiameter
+glm::ivec2 ProceduralSegments(const ProceduralMesh& mesh, float projected_diameter, float max_pixel_error = 0.5f);
+
+// Draws one triangle strip per column, the shader's u_procedural_segments must match segments.
+// Instance mesh_instance * (segments.y - 1) + column draws column of mesh_instance.
+void DrawProceduralMesh(const ProceduralMesh& mesh, const glm::ivec2& segments, int mesh_instance_count = 1);
+
+// Triangles with area, the degenerate ones joining the strips are not counted
+int ProceduralTriangleCount(const glm::ivec2& segments);
\ No newline at end of file
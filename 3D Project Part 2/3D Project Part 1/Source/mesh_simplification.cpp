@@ -0,0 +1,422 @@
+#include "mesh_simplification.h"
+
+#include <algorithm>
+
+#include "mesh_optimization.h"
+
+/* Mesh Simplification Constants */
+
+// Open borders and uv seams are kept straight by planes through them, weighted this much more than the surface
+static const double feature_edge_weight = 10;
+
+// A collapse is rejected when it turns a triangle more than about 75 degrees away from its original normal
+static const double min_normal_cosine = 0.25;
+
+/* Helper Structs */
+
+// Manifold vertices can move onto any neighbour, Border and Seam vertices only along their
+// border or seam, Locked vertices never move, e.g. corners of borders and ends of seams
+enum class VertexKind
+{
+	Manifold,
+	Border,
+	Seam,
+	Locked
+};
+
+// Sum of squared distances to weighted planes, p^T A p + 2 b^T p + c, A is symmetric
+struct Quadric
+{
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+	double weight;
+};
+
+// Vertex v moves onto vertex w
+struct Collapse
+{
+	GLuint v;
+	GLuint w;
+	double cost;
+};
+
+/* Helper Functions */
+
+static Quadric PlaneQuadric(const glm::dvec3& normal, double distance, double weight)
+{
+	Quadric quadric;
+	quadric.a00 = weight * normal.x * normal.x;
+	quadric.a01 = weight * normal.x * normal.y;
+	quadric.a02 = weight * normal.x * normal.z;
+	quadric.a11 = weight * normal.y * normal.y;
+	quadric.a12 = weight * normal.y * normal.z;
+	quadric.a22 = weight * normal.z * normal.z;
+	quadric.b0 = weight * normal.x * distance;
+	quadric.b1 = weight * normal.y * distance;
+	quadric.b2 = weight * normal.z * distance;
+	quadric.c = weight * distance * distance;
+	quadric.weight = weight;
+	return quadric;
+}
+
+static void AddQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.a00 += other.a00;
+	quadric.a01 += other.a01;
+	quadric.a02 += other.a02;
+	quadric.a11 += other.a11;
+	quadric.a12 += other.a12;
+	quadric.a22 += other.a22;
+	quadric.b0 += other.b0;
+	quadric.b1 += other.b1;
+	quadric.b2 += other.b2;
+	quadric.c += other.c;
+	quadric.weight += other.weight;
+}
+
+// Weighted mean of the squared distances, so the error is in mesh space however many planes were added
+static double QuadricError(const Quadric& quadric, const glm::dvec3& p)
+{
+	auto error = quadric.a00 * p.x * p.x + quadric.a11 * p.y * p.y + quadric.a22 * p.z * p.z
+		+ 2 * (quadric.a01 * p.x * p.y + quadric.a02 * p.x * p.z + quadric.a12 * p.y * p.z)
+		+ 2 * (quadric.b0 * p.x + quadric.b1 * p.y + quadric.b2 * p.z)
+		+ quadric.c;
+	return quadric.weight > 0 ? glm::abs(error) / quadric.weight : 0;
+}
+
+/* Mesh Simplification Functions */
+SimplificationReport SimplifyMesh(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	size_t target_triangle_count,
+	float max_error
+)
+{
+	SimplificationReport report;
+	report.triangles_before = indices.size() / 3;
+	report.triangles_after = report.triangles_before;
+	report.error = 0;
+	if (report.triangles_before <= target_triangle_count)
+		return report;
+
+	auto vertex_count = positions.size();
+
+	// Vertices at the same position share the quadric and kind of the first one, their group
+	auto groups = PositionRemap(positions);
+
+	// The other vertices at the same position, as a cycle through next_wedge
+	std::vector<GLuint> next_wedge(vertex_count);
+	std::vector<int> wedge_counts(vertex_count, 0);
+	for (size_t v = 0; v < vertex_count; ++v)
+		next_wedge[v] = GLuint(v);
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		++wedge_counts[groups[v]];
+		if (groups[v] != v)
+		{
+			next_wedge[v] = next_wedge[groups[v]];
+			next_wedge[groups[v]] = GLuint(v);
+		}
+	}
+
+	// Triangles around every group, rebuilt after every pass of collapses
+	std::vector<GLuint> triangle_offsets(vertex_count + 1);
+	std::vector<GLuint> vertex_triangles;
+	auto BuildAdjacency = [&]()
+	{
+		std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+		for (auto index : indices)
+			++triangle_offsets[groups[index] + 1];
+		for (size_t v = 0; v < vertex_count; ++v)
+			triangle_offsets[v + 1] += triangle_offsets[v];
+
+		vertex_triangles.resize(indices.size());
+		std::vector<GLuint> fill_offsets(triangle_offsets.begin(), triangle_offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+			vertex_triangles[fill_offsets[groups[indices[i]]]++] = GLuint(i / 3);
+	};
+
+	// Whether a triangle has the edge from a to b, between the vertices themselves or any vertices at their positions
+	auto HasEdge = [&](GLuint a, GLuint b, bool same_vertices)
+	{
+		for (auto i = triangle_offsets[groups[a]]; i < triangle_offsets[groups[a] + 1]; ++i)
+		{
+			auto triangle = &indices[vertex_triangles[i] * 3];
+			for (int k = 0; k < 3; ++k)
+			{
+				auto from = triangle[k];
+				auto to = triangle[(k + 1) % 3];
+				if (same_vertices ? from == a && to == b : groups[from] == groups[a] && groups[to] == groups[b])
+					return true;
+			}
+		}
+		return false;
+	};
+
+	// An edge without its reverse is on an open border when the positions have no reverse either,
+	// and on a uv seam otherwise
+	auto IsBorderEdge = [&](GLuint a, GLuint b)
+	{
+		return !HasEdge(b, a, false) || !HasEdge(a, b, false);
+	};
+	auto IsSeamEdge = [&](GLuint a, GLuint b)
+	{
+		return (!HasEdge(b, a, true) || !HasEdge(a, b, true)) && !IsBorderEdge(a, b);
+	};
+
+	BuildAdjacency();
+
+	// Border vertices have one border edge in and one out, each wedge of a seam vertex one seam edge in and one out
+	std::vector<int> border_edge_counts(vertex_count, 0);
+	std::vector<int> seam_edge_counts(vertex_count, 0);
+	for (size_t t = 0; t < indices.size(); t += 3)
+		for (int k = 0; k < 3; ++k)
+		{
+			auto a = indices[t + k];
+			auto b = indices[t + (k + 1) % 3];
+			if (HasEdge(b, a, true))
+				continue;
+
+			if (!HasEdge(b, a, false))
+			{
+				++border_edge_counts[groups[a]];
+				++border_edge_counts[groups[b]];
+			}
+			else
+			{
+				++seam_edge_counts[a];
+				++seam_edge_counts[b];
+			}
+		}
+
+	std::vector<VertexKind> kinds(vertex_count, VertexKind::Locked);
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		if (groups[v] != v)
+			continue;
+
+		auto other_wedge = next_wedge[v];
+		if (wedge_counts[v] == 1 && border_edge_counts[v] == 0 && seam_edge_counts[v] == 0)
+			kinds[v] = VertexKind::Manifold;
+		else if (wedge_counts[v] == 1 && border_edge_counts[v] == 2 && seam_edge_counts[v] == 0)
+			kinds[v] = VertexKind::Border;
+		else if (wedge_counts[v] == 2 && border_edge_counts[v] == 0 && seam_edge_counts[v] == 2 && seam_edge_counts[other_wedge] == 2)
+			kinds[v] = VertexKind::Seam;
+	}
+
+	// Surface planes weighted by area, and planes through the border and seam edges perpendicular to their triangle
+	std::vector<Quadric> quadrics(vertex_count, Quadric());
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		glm::dvec3 corners[3] = { positions[indices[t]], positions[indices[t + 1]], positions[indices[t + 2]] };
+		auto normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		auto double_area = glm::length(normal);
+		if (double_area == 0)
+			continue;
+
+		normal /= double_area;
+		auto plane = PlaneQuadric(normal, -glm::dot(normal, corners[0]), double_area / 2);
+		for (int k = 0; k < 3; ++k)
+			AddQuadric(quadrics[groups[indices[t + k]]], plane);
+
+		for (int k = 0; k < 3; ++k)
+		{
+			if (HasEdge(indices[t + (k + 1) % 3], indices[t + k], true))
+				continue;
+
+			auto a = indices[t + k];
+			auto b = indices[t + (k + 1) % 3];
+			auto edge = corners[(k + 1) % 3] - corners[k];
+			auto edge_normal = glm::cross(edge, normal);
+			auto edge_length = glm::length(edge);
+			if (edge_length == 0)
+				continue;
+
+			edge_normal = glm::normalize(edge_normal);
+			auto edge_plane = PlaneQuadric(edge_normal, -glm::dot(edge_normal, corners[k]), edge_length * edge_length * feature_edge_weight);
+			AddQuadric(quadrics[groups[a]], edge_plane);
+			AddQuadric(quadrics[groups[b]], edge_plane);
+		}
+	}
+
+	// Unit normals of the triangles before any collapse, kept in the order of the triangles that remain.
+	// Collapses are checked against them, so the turns of several collapses can not add up to a fold.
+	std::vector<glm::dvec3> original_normals(indices.size() / 3);
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		glm::dvec3 corners[3] = { positions[indices[t]], positions[indices[t + 1]], positions[indices[t + 2]] };
+		auto normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		auto length = glm::length(normal);
+		original_normals[t / 3] = length > 0 ? normal / length : glm::dvec3(0);
+	}
+
+	auto CanCollapse = [&](GLuint v, GLuint w)
+	{
+		if (groups[v] == groups[w])
+			return false;
+
+		switch (kinds[groups[v]])
+		{
+		case VertexKind::Manifold:
+			return true;
+		case VertexKind::Border:
+			return IsBorderEdge(v, w);
+		case VertexKind::Seam:
+			return IsSeamEdge(v, w);
+		default:
+			return false;
+		}
+	};
+
+	auto max_cost = double(max_error) * max_error;
+	double collapse_cost = 0;
+	auto triangle_count = indices.size() / 3;
+
+	std::vector<GLuint> collapse_remap(vertex_count);
+	std::vector<char> locked(vertex_count);
+	std::vector<Collapse> collapses;
+
+	// Every pass collapses the cheapest edges whose neighbourhoods do not overlap, then rebuilds the adjacency
+	while (triangle_count > target_triangle_count)
+	{
+		// Every edge once, from the triangle where it goes to the higher group or that has no neighbour
+		// across it, in whichever direction is cheaper
+		collapses.clear();
+		for (size_t t = 0; t < indices.size(); t += 3)
+			for (int k = 0; k < 3; ++k)
+			{
+				auto a = indices[t + k];
+				auto b = indices[t + (k + 1) % 3];
+				if (groups[a] > groups[b] && HasEdge(b, a, false))
+					continue;
+
+				auto cost_a = CanCollapse(a, b) ? QuadricError(quadrics[groups[a]], glm::dvec3(positions[b])) : -1;
+				auto cost_b = CanCollapse(b, a) ? QuadricError(quadrics[groups[b]], glm::dvec3(positions[a])) : -1;
+				if (cost_a >= 0 && (cost_b < 0 || cost_a <= cost_b))
+					collapses.push_back(Collapse{ a, b, cost_a });
+				else if (cost_b >= 0)
+					collapses.push_back(Collapse{ b, a, cost_b });
+			}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		for (size_t v = 0; v < vertex_count; ++v)
+			collapse_remap[v] = GLuint(v);
+		std::fill(locked.begin(), locked.end(), 0);
+
+		size_t removed_triangles = 0;
+		size_t performed_collapses = 0;
+		for (auto& collapse : collapses)
+		{
+			if (collapse.cost > max_cost)
+				break;
+
+			auto group_v = groups[collapse.v];
+			auto group_w = groups[collapse.w];
+			if (locked[group_v] || locked[group_w])
+				continue;
+
+			// The twin of a seam vertex moves onto the wedge of w on its side of the seam
+			auto twin_v = next_wedge[collapse.v];
+			auto twin_w = GLuint(~0u);
+			if (kinds[group_v] == VertexKind::Seam)
+			{
+				for (auto i = triangle_offsets[group_v]; i < triangle_offsets[group_v + 1] && twin_w == ~0u; ++i)
+				{
+					auto triangle = &indices[vertex_triangles[i] * 3];
+					if (triangle[0] != twin_v && triangle[1] != twin_v && triangle[2] != twin_v)
+						continue;
+					for (int k = 0; k < 3; ++k)
+						if (groups[triangle[k]] == group_w && IsSeamEdge(twin_v, triangle[k]))
+							twin_w = triangle[k];
+				}
+				if (twin_w == ~0u)
+					continue;
+			}
+
+			// Triangles around v that keep their area must not flip, lose their area or turn too far
+			glm::dvec3 position_w = positions[collapse.w];
+			size_t collapsed_triangles = 0;
+			auto valid = true;
+			for (auto i = triangle_offsets[group_v]; i < triangle_offsets[group_v + 1] && valid; ++i)
+			{
+				auto triangle = &indices[vertex_triangles[i] * 3];
+				if (groups[triangle[0]] == group_w || groups[triangle[1]] == group_w || groups[triangle[2]] == group_w)
+				{
+					++collapsed_triangles;
+					continue;
+				}
+
+				glm::dvec3 corners[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+				for (int k = 0; k < 3; ++k)
+					if (groups[triangle[k]] == group_v)
+						corners[k] = position_w;
+				auto new_normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+				auto new_length = glm::length(new_normal);
+
+				valid = new_length > 0 && glm::dot(original_normals[vertex_triangles[i]], new_normal) >= min_normal_cosine * new_length;
+			}
+			if (!valid)
+				continue;
+
+			collapse_remap[collapse.v] = collapse.w;
+			if (kinds[group_v] == VertexKind::Seam)
+				collapse_remap[twin_v] = twin_w;
+			AddQuadric(quadrics[group_w], quadrics[group_v]);
+
+			// Nothing around v can change again in this pass, the adjacency is out of date there
+			for (auto i = triangle_offsets[group_v]; i < triangle_offsets[group_v + 1]; ++i)
+			{
+				auto triangle = &indices[vertex_triangles[i] * 3];
+				for (int k = 0; k < 3; ++k)
+					locked[groups[triangle[k]]] = 1;
+			}
+
+			collapse_cost = glm::max(collapse_cost, collapse.cost);
+			removed_triangles += collapsed_triangles;
+			++performed_collapses;
+			if (triangle_count - removed_triangles <= target_triangle_count)
+				break;
+		}
+
+		if (performed_collapses == 0)
+			break;
+
+		// Triangles that lost their area are removed
+		size_t write = 0;
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			auto a = collapse_remap[indices[t]];
+			auto b = collapse_remap[indices[t + 1]];
+			auto c = collapse_remap[indices[t + 2]];
+			if (groups[a] == groups[b] || groups[b] == groups[c] || groups[a] == groups[c])
+				continue;
+
+			original_normals[write / 3] = original_normals[t / 3];
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+		original_normals.resize(write / 3);
+		triangle_count = indices.size() / 3;
+
+		BuildAdjacency();
+	}
+
+	// Vertices that no triangle uses anymore are moved to the end and dropped
+	OptimizeVertexFetch(positions, normals, uvs, indices);
+	size_t used_vertices = 0;
+	for (auto index : indices)
+		used_vertices = glm::max(used_vertices, size_t(index) + 1);
+	positions.resize(used_vertices);
+	normals.resize(used_vertices);
+	uvs.resize(used_vertices);
+
+	report.triangles_after = triangle_count;
+	report.error = float(glm::sqrt(collapse_cost));
+	return report;
+}
\ No newline at end of file
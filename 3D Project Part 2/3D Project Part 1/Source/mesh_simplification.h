@@ -0,0 +1,40 @@
+#pragma once
+
+#include <iostream>
+#include <limits>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/* Mesh Simplification Structs */
+
+struct SimplificationReport
+{
+	size_t triangles_before;
+	size_t triangles_after;
+
+	// Square root of the largest quadric error of a collapse, in mesh space. Quadric errors are weighted
+	// means of squared plane distances, so the surface can be further than this from where it was.
+	float error;
+};
+
+/* Mesh Simplification Functions */
+
+// Collapses edges in order of their quadric error (Garland and Heckbert, "Surface Simplification
+// Using Quadric Error Metrics") until the mesh has at most target_triangle_count triangles, or
+// no collapse under max_error is left. Vertices only move onto their neighbours, so normals and
+// uvs stay valid, and unused vertices are removed.
+//
+// Vertices with more than one set of attributes at the same position are uv seams, they only
+// move along the seam together with their twin. Open borders only move along the border, and
+// both are kept straight by extra planes through their edges. Collapses that would turn a
+// triangle more than about 75 degrees from its normal before simplifying, fold it over or take
+// its area are rejected, which keeps the silhouette from caving in.
+SimplificationReport SimplifyMesh(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>& uvs,
+	std::vector<GLuint>& indices,
+	size_t target_triangle_count,
+	float max_error = std::numeric_limits<float>::max()
+);
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "mesh_streaming.h"
+
+#include <cstring>
+
+/* Mesh Streaming Constants */
+
+// Rows of quads per band, a band of B rows transforms B + 1 new vertices for every 2 * B
+// triangles while the previous column's B + 1 vertices still fit in a 16 entry cache
+static const int band_rows = 7;
+
+// glUnmapBuffer reports a lost data store, e.g. after a display mode change, the chunk is rewritten then
+static const int max_map_attempts = 3;
+
+/* Helper Functions */
+
+// Maps size bytes at offset of the buffer bound to target, calls write(mapping) and unmaps it.
+// Returns false when the range could not be mapped, or its data store was lost every time.
+template <typename Write>
+static bool WriteBufferRange(GLenum target, size_t offset, size_t size, Write write)
+{
+	for (int attempt = 0; attempt < max_map_attempts; ++attempt)
+	{
+		// The buffers are new and no draw has used them yet, so nothing needs to be synchronized
+		auto mapping = glMapBufferRange(target, GLintptr(offset), GLsizeiptr(size),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (mapping == nullptr)
+			return false;
+
+		write(mapping);
+		if (glUnmapBuffer(target) == GL_TRUE)
+			return true;
+	}
+	return false;
+}
+
+// Writes the range through a mapping, or when that fails, into a copy of the range that
+// glBufferSubData uploads
+template <typename Write>
+static void StreamBufferRange(GLenum target, size_t offset, size_t size, MeshStreamingReport& report, Write write)
+{
+	if (size == 0)
+		return;
+
+	report.staging_bytes = glm::max(report.staging_bytes, size);
+	++report.chunk_count;
+
+	if (WriteBufferRange(target, offset, size, write))
+		return;
+
+	std::vector<unsigned char> staging(size);
+	write(staging.data());
+	glBufferSubData(target, GLintptr(offset), GLsizeiptr(size), staging.data());
+	++report.copied_chunk_count;
+}
+
+/* Mesh Streaming Functions */
+VAO StreamParametricShapeFrom2D(
+	ParametricLineBatch parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	VertexLayout layout,
+	RevolutionTopology topology,
+	size_t staging_bytes,
+	MeshStreamingReport* report
+)
+{
+	auto profile = detail::SampleParametricProfile(parametric_line, vertical_segments);
+	std::vector<double> profile_t(vertical_segments);
+	for (int v = 0; v < vertical_segments; ++v)
+		profile_t[v] = v / double(vertical_segments - 1);
+
+	auto plan = detail::PlanRevolution(profile, profile_t, rotation_segments, topology);
+
+	// Null data only allocates the buffers
+	VertexData data = {};
+	data.layout = layout;
+	data.vertex_count = GLsizei(plan.vertex_count);
+	data.index_count = GLsizei(plan.index_count);
+	QuantizationBounds(
+		glm::vec3(-plan.max_radius, plan.min_y, -plan.max_radius),
+		glm::vec3(plan.max_radius, plan.max_y, plan.max_radius),
+		data.position_scale, data.position_offset);
+
+	VAO vao(data);
+
+	MeshStreamingReport streaming_report = {};
+	for (int v = 0; v < vertical_segments; ++v)
+		streaming_report.bounding_radius = glm::max(streaming_report.bounding_radius,
+			glm::length(glm::vec2(plan.profile_x[v], plan.profile_y[v])));
+
+	// Writes the vertices [first_vertex, end_vertex) to the buffers of the layout, write_vertices(write_vertex)
+	// calls write_vertex(index, position, normal, uv) for exactly those vertices
+	auto WriteVertices = [&](GLuint first_vertex, GLuint end_vertex, auto write_vertices)
+	{
+		auto count = size_t(end_vertex - first_vertex);
+		if (layout == VertexLayout::Separate)
+		{
+			// Evaluated once into arrays the size of the chunk, which are copied into the three buffers
+			std::vector<glm::vec3> positions(count);
+			std::vector<glm::vec3> normals(count);
+			std::vector<glm::vec2> uvs(count);
+			write_vertices([&](GLuint index, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+			{
+				positions[index - first_vertex] = position;
+				normals[index - first_vertex] = normal;
+				uvs[index - first_vertex] = uv;
+			});
+
+			auto StreamArray = [&](GLuint buffer, const auto& values)
+			{
+				auto bytes = values.size() * sizeof(values[0]);
+				glBindBuffer(GL_ARRAY_BUFFER, buffer);
+				StreamBufferRange(GL_ARRAY_BUFFER, first_vertex * sizeof(values[0]), bytes, streaming_report, [&](void* mapping)
+				{
+					memcpy(mapping, values.data(), bytes);
+				});
+			};
+			StreamArray(vao.position_buffer, positions);
+			StreamArray(vao.normals_buffer, normals);
+			StreamArray(vao.uv_buffer, uvs);
+		}
+		else
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, vao.interleaved_buffer);
+			StreamBufferRange(GL_ARRAY_BUFFER, first_vertex * sizeof(QuantizedVertex), count * sizeof(QuantizedVertex), streaming_report, [&](void* mapping)
+			{
+				auto vertices = static_cast<QuantizedVertex*>(mapping) - first_vertex;
+				write_vertices([&](GLuint index, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+				{
+					vertices[index] = QuantizeVertex(position, normal, uv, vao.position_scale, vao.position_offset);
+				});
+			});
+		}
+	};
+
+	// Vertices, in chunks of whole rings
+	auto ring_bytes = glm::max(size_t(plan.ring_vertex_count) * (layout == VertexLayout::Separate ? sizeof(glm::vec3) : sizeof(QuantizedVertex)), size_t(1));
+	auto rings_per_chunk = int(glm::max(staging_bytes / ring_bytes, size_t(1)));
+	for (int first_ring = 0; first_ring < plan.ring_count; first_ring += rings_per_chunk)
+	{
+		auto end_ring = glm::min(first_ring + rings_per_chunk, plan.ring_count);
+		WriteVertices(GLuint(first_ring * plan.ring_vertex_count), GLuint(end_ring * plan.ring_vertex_count), [&](auto write_vertex)
+		{
+			detail::ParallelFor(end_ring - first_ring, [&](int begin, int end)
+			{
+				auto thread_write_vertex = write_vertex;
+				for (int r = first_ring + begin; r < first_ring + end; ++r)
+					detail::WriteRevolutionRing(plan, r, thread_write_vertex);
+			});
+		});
+	}
+
+	WriteVertices(GLuint(plan.pole_base), GLuint(plan.vertex_count), [&](auto write_vertex)
+	{
+		detail::WriteRevolutionPoles(plan, write_vertex);
+	});
+
+	// Indices, in chunks of whole columns
+	auto column_index_count = size_t(plan.column_triangle_count) * 3;
+	auto columns_per_chunk = int(glm::max(staging_bytes / (column_index_count * sizeof(GLuint)), size_t(1)));
+	for (int first_column = 0; first_column < rotation_segments - 1; first_column += columns_per_chunk)
+	{
+		auto end_column = glm::min(first_column + columns_per_chunk, rotation_segments - 1);
+		auto chunk_index_count = size_t(end_column - first_column) * column_index_count;
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao.element_array_buffer);
+		StreamBufferRange(GL_ELEMENT_ARRAY_BUFFER, first_column * column_index_count * sizeof(GLuint), chunk_index_count * sizeof(GLuint), streaming_report, [&](void* mapping)
+		{
+			auto indices = static_cast<GLuint*>(mapping);
+			for (int band_begin = 0; band_begin < vertical_segments - 1; band_begin += band_rows)
+			{
+				auto band_end = glm::min(band_begin + band_rows, vertical_segments - 1);
+				for (int r = first_column; r < end_column; ++r)
+					indices = detail::WriteRevolutionTriangles(plan, r, band_begin, band_end, indices);
+			}
+		});
+	}
+
+	if (report != nullptr)
+		*report = streaming_report;
+	return vao;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "opengl_utilities.h"
+#include "mesh_generation.h"
+
+/* Mesh Streaming Structs */
+
+struct MeshStreamingReport
+{
+	// Largest range that was written at once, the number of ranges written, and how many of
+	// them could not be mapped and were uploaded from a copy by glBufferSubData instead
+	size_t staging_bytes;
+	int chunk_count;
+	int copied_chunk_count;
+
+	// Bounding sphere around the mesh space origin
+	float bounding_radius;
+};
+
+/* Mesh Streaming Functions */
+
+// Same mesh as GenerateParametricShapeFrom2D, written straight into the buffers of the VAO.
+// The buffers are mapped in chunks of whole rings or columns of at most staging_bytes, so
+// no CPU copy of the whole mesh exists at any point. A ring or column larger than staging_bytes
+// is mapped on its own. The separate layout evaluates a chunk once into arrays of its size,
+// which are copied into its three buffers, and a chunk that cannot be mapped is uploaded
+// from a copy with glBufferSubData.
+//
+// Triangles are written in bands of a few rows across the columns of a chunk instead of
+// column by column, so the order is already friendly to the post-transform cache without
+// running OptimizeMesh. Quantized positions use the bounds of the profile, which contain
+// the mesh but can be slightly larger than it.
+VAO StreamParametricShapeFrom2D(
+	ParametricLineBatch parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	VertexLayout layout,
+	RevolutionTopology topology = RevolutionTopology(),
+	size_t staging_bytes = 1 << 20,
+	MeshStreamingReport* report = nullptr
+);
\ No newline at end of file
@@ -0,0 +1,232 @@
+#include "mesh_terrain.h"
+
+#include <cstddef>
+#include <limits>
+#include "GLM/gtc/constants.hpp"
+
+#include "mesh_culling.h"
+
+/* Terrain Constants */
+
+// Nodes are split closer than detail times their edge length. Below min_terrain_detail a node
+// can end up next to one two levels coarser, and the morph can not close the gap between them.
+static const float max_terrain_detail = 16;
+static const float min_terrain_detail = 4;
+
+// Bisection steps for the finest detail within the triangle budget
+static const int terrain_detail_search_steps = 6;
+
+// The detail of the last frame is kept while the selection uses at least this part of the budget
+static const float terrain_budget_reuse = 0.75f;
+
+// Part of its range over which a node morphs into its parent, vertices start moving at
+// morph_start_fraction of it. Nodes next to a coarser node have to be fully morphed where they
+// meet, which holds when the coarser node has not started morphing there yet.
+static const float morph_start_fraction = 0.75f;
+
+/* Helper Functions */
+
+struct TerrainSelection
+{
+	Terrain* terrain;
+	PatchCuller culler;
+	float detail;
+	int depth_limit;
+	int deepest_level;
+
+	// The selection stops once it has more nodes than this, it is over the budget anyway
+	size_t max_nodes;
+
+	// Largest angle between neighbouring grid vertices, the triangles dip under the sphere
+	// and their normals tilt by up to this much
+	float grid_angle;
+};
+
+static void SelectNode(TerrainSelection& selection, int face, const glm::vec2& corner, float size, int depth)
+{
+	if (selection.terrain->instances.size() > selection.max_nodes)
+		return;
+
+	// Node edges are great circles, so the corners are the points farthest from the center
+	auto center = TerrainFacePoint(face, corner + size / 2);
+	float angle = 0;
+	for (int k = 0; k < 4; ++k)
+	{
+		auto node_corner = corner + size * glm::vec2(k % 2, k / 2);
+		angle = glm::max(angle, glm::acos(glm::clamp(glm::dot(center, TerrainFacePoint(face, node_corner)), -1.f, 1.f)));
+	}
+
+	// Bounding sphere of the spherical cap within angle of the center, and of everything displaced
+	// from it. The slopes of the displaced surface are unknown, so its normals can point anywhere.
+	auto max_elevation = selection.terrain->max_elevation;
+	auto sphere_center = center * glm::cos(angle);
+	auto sphere_radius = glm::sin(angle) + max_elevation;
+	auto cone_angle = max_elevation > 0 ? glm::pi<float>() : angle + selection.grid_angle;
+	if (CullPatch(selection.culler, sphere_center, sphere_radius, center, cone_angle) != PatchVisibility::Visible)
+		return;
+
+	auto edge = glm::half_pi<float>() * size / 2;
+	auto distance = glm::max(glm::length(selection.culler.camera - sphere_center) - sphere_radius, 0.f);
+	if (depth < selection.depth_limit && distance < selection.detail * edge)
+	{
+		for (int k = 0; k < 4; ++k)
+			SelectNode(selection, face, corner + size / 2 * glm::vec2(k % 2, k / 2), size / 2, depth + 1);
+		return;
+	}
+
+	// Vertices reach the grid of the parent where the parent would stop being split,
+	// the faces have no parent and never morph
+	TerrainInstance instance;
+	instance.corner = corner;
+	instance.size = size;
+	instance.face = float(face);
+	instance.morph_end = depth == 0 ? std::numeric_limits<float>::max() : selection.detail * edge * 2;
+	instance.morph_start = depth == 0 ? std::numeric_limits<float>::max() / 2 : instance.morph_end * morph_start_fraction;
+	selection.terrain->instances.push_back(instance);
+	selection.deepest_level = glm::max(selection.deepest_level, depth);
+}
+
+/* Terrain Functions */
+glm::vec3 TerrainFacePoint(int face, const glm::vec2& point)
+{
+	glm::vec3 axes[] = { glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1) };
+	auto normal = axes[face / 2] * (face % 2 == 0 ? 1.f : -1.f);
+	auto tangent = axes[(face / 2 + 1) % 3];
+	auto bitangent = axes[(face / 2 + 2) % 3];
+
+	// Equal angle projection, tan(s * PI/4) spreads the vertices evenly over the sphere
+	auto cube = normal + point.x * tangent + point.y * bitangent;
+	return glm::normalize(glm::tan(cube * glm::quarter_pi<float>()));
+}
+
+Terrain CreateTerrain(int grid_segments, int max_depth, int triangle_budget)
+{
+	Terrain terrain;
+	terrain.grid_segments = grid_segments;
+	terrain.max_depth = max_depth;
+	terrain.triangle_budget = triangle_budget;
+	terrain.detail = 0;
+	terrain.depth_limit = max_depth;
+	terrain.max_elevation = 0;
+
+	std::vector<glm::vec2> grid;
+	grid.reserve(size_t(grid_segments + 1) * (grid_segments + 1));
+	for (int j = 0; j <= grid_segments; ++j)
+		for (int i = 0; i <= grid_segments; ++i)
+			grid.push_back(glm::vec2(i, j));
+
+	// Every quad is split along the same diagonal, so a fully morphed grid covers the grid of the parent
+	std::vector<GLuint> indices;
+	indices.reserve(size_t(grid_segments) * grid_segments * 6);
+	for (int j = 0; j < grid_segments; ++j)
+		for (int i = 0; i < grid_segments; ++i)
+		{
+			auto a = GLuint(j * (grid_segments + 1) + i);
+			auto b = a + 1;
+			auto c = b + grid_segments + 1;
+			auto d = a + grid_segments + 1;
+			indices.insert(indices.end(), { a, b, c, a, c, d });
+		}
+	terrain.index_count = GLsizei(indices.size());
+
+	glGenVertexArrays(1, &terrain.vao);
+	glBindVertexArray(terrain.vao);
+
+	glGenBuffers(1, &terrain.grid_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, terrain.grid_buffer);
+	glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(glm::vec2), grid.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, static_cast<void*>(0));
+	glEnableVertexAttribArray(0);
+
+	// Rewritten every frame by SelectTerrainNodes
+	auto stride = GLsizei(sizeof(TerrainInstance));
+	glGenBuffers(1, &terrain.instance_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, terrain.instance_buffer);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(TerrainInstance, corner)));
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(TerrainInstance, morph_start)));
+	glVertexAttribDivisor(4, 1);
+	glEnableVertexAttribArray(4);
+
+	glGenBuffers(1, &terrain.index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrain.index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+	return terrain;
+}
+
+TerrainSelectionReport SelectTerrainNodes(
+	Terrain& terrain,
+	const glm::mat4& model,
+	const glm::mat4& projection_view,
+	const glm::vec3& camera_position
+)
+{
+	TerrainSelection selection;
+	selection.terrain = &terrain;
+	selection.grid_angle = glm::half_pi<float>() / terrain.grid_segments;
+	selection.culler = CreatePatchCuller(model, projection_view, camera_position,
+		glm::cos(selection.grid_angle) * (1 - terrain.max_elevation));
+
+	auto triangles_per_node = 2 * terrain.grid_segments * terrain.grid_segments;
+	selection.max_nodes = size_t(glm::max(terrain.triangle_budget / triangles_per_node, 1));
+	auto Select = [&](float detail)
+	{
+		selection.detail = detail;
+		selection.deepest_level = 0;
+		terrain.instances.clear();
+		for (int face = 0; face < 6; ++face)
+			SelectNode(selection, face, glm::vec2(-1), 2, 0);
+		return terrain.instances.size() <= selection.max_nodes;
+	};
+
+	// Frames in a row need about the same detail, it is only searched for again when
+	// the last one does not fit anymore or leaves too much of the budget unused
+	selection.depth_limit = terrain.depth_limit;
+	auto keep_detail = terrain.detail > 0 && Select(terrain.detail)
+		&& (terrain.detail == max_terrain_detail || terrain.instances.size() >= terrain_budget_reuse * selection.max_nodes);
+
+	// More detail only ever splits more nodes, so the finest detail within the budget is found by
+	// bisection. The trees get shallower when even the coarsest ranges are over the budget.
+	if (!keep_detail)
+		selection.depth_limit = terrain.max_depth;
+	if (!keep_detail && !Select(max_terrain_detail))
+	{
+		while (!Select(min_terrain_detail) && selection.depth_limit > 0)
+			--selection.depth_limit;
+
+		auto low = min_terrain_detail;
+		auto high = max_terrain_detail;
+		for (int step = 0; step < terrain_detail_search_steps; ++step)
+		{
+			auto middle = (low + high) / 2;
+			if (Select(middle))
+				low = middle;
+			else
+				high = middle;
+		}
+		Select(low);
+	}
+
+	terrain.detail = selection.detail;
+	terrain.depth_limit = selection.depth_limit;
+
+	glBindBuffer(GL_ARRAY_BUFFER, terrain.instance_buffer);
+	glBufferData(GL_ARRAY_BUFFER, terrain.instances.size() * sizeof(TerrainInstance), terrain.instances.data(), GL_STREAM_DRAW);
+
+	TerrainSelectionReport report;
+	report.node_count = int(terrain.instances.size());
+	report.triangle_count = report.node_count * triangles_per_node;
+	report.deepest_level = selection.deepest_level;
+	report.depth_limit = selection.depth_limit;
+	report.detail = selection.detail;
+	return report;
+}
+
+void DrawTerrain(const Terrain& terrain)
+{
+	glBindVertexArray(terrain.vao);
+	glDrawElementsInstanced(GL_TRIANGLES, terrain.index_count, GL_UNSIGNED_INT, 0, GLsizei(terrain.instances.size()));
+}
\ No newline at end of file
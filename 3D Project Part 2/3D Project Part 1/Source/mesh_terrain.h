@@ -0,0 +1,83 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/* Terrain Structs */
+
+// Per instance attributes of a selected node. The node covers [corner, corner + size] of its
+// cube face in face coordinates [-1, 1], its vertices move onto the grid of its parent between
+// morph_start and morph_end distance from the camera in mesh space.
+struct TerrainInstance
+{
+	glm::vec2 corner;
+	float size;
+	float face;
+	float morph_start;
+	float morph_end;
+};
+
+// A unit sphere drawn as a quadtree over the six faces of a cube (CDLOD, Strugar, "Continuous
+// Distance-Dependent Level of Detail for Rendering Heightmaps"). Every selected node is an instance
+// of the same grid, the vertex shader projects it onto the sphere with the equal angle projection
+// of GenerateCubeSphere. Vertices of attribute 0 are grid coordinates in [0, grid_segments],
+// instances are attributes 3 and 4, see TerrainInstance.
+struct Terrain
+{
+	GLuint vao;
+	GLuint grid_buffer;
+	GLuint index_buffer;
+	GLuint instance_buffer;
+
+	int grid_segments;
+	GLsizei index_count;
+	int max_depth;
+	int triangle_budget;
+
+	// Nodes of the last SelectTerrainNodes, uploaded to instance_buffer
+	std::vector<TerrainInstance> instances;
+
+	// Settings of the last selection, see TerrainSelectionReport, kept while they fit the budget
+	float detail;
+	int depth_limit;
+
+	// Vertices are displaced up to this far along the normal in mesh space, see mesh_elevation.h.
+	// The bounds of the nodes grow by it, and nodes are no longer culled for facing away.
+	float max_elevation;
+};
+
+struct TerrainSelectionReport
+{
+	int node_count;
+	int triangle_count;
+	int deepest_level;
+
+	// Below max_depth when even the coarsest detail is over the budget
+	int depth_limit;
+
+	// Nodes of edge length e were split closer than detail * e to the camera, lowered
+	// from the finest setting until the selection fits the triangle budget
+	float detail;
+};
+
+/* Terrain Functions */
+
+// Point of the unit sphere at face coordinates point in [-1, 1] of the cube face, same as the terrain vertex shader
+glm::vec3 TerrainFacePoint(int face, const glm::vec2& point);
+
+// max_depth splits of a face give vertices (pi / 2) / (grid_segments << max_depth) radians apart
+Terrain CreateTerrain(int grid_segments = 32, int max_depth = 10, int triangle_budget = 262144);
+
+// Picks the nodes for the camera and uploads them. The camera is in world space, model is the
+// transform of the unit sphere, it may rotate and translate but only scale uniformly.
+TerrainSelectionReport SelectTerrainNodes(
+	Terrain& terrain,
+	const glm::mat4& model,
+	const glm::mat4& projection_view,
+	const glm::vec3& camera_position
+);
+
+// Draws the nodes of the last selection, the shader needs the camera in mesh space for the morph
+void DrawTerrain(const Terrain& terrain);
\ No newline at end of file
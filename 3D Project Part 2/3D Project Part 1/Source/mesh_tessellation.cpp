@@ -0,0 +1,294 @@
+#include "mesh_tessellation.h"
+
+#include <string>
+#include <vector>
+#include "GLM/gtc/constants.hpp"
+#include "GLM/gtc/type_ptr.hpp"
+
+#include "opengl_utilities.h"
+#include "uniform_buffers.h"
+#include "mesh_culling.h"
+#include "mesh_terrain.h"
+
+/* Tessellation Constants */
+
+// The tessellator only has to support 64
+static const int max_tessellation_level = 64;
+
+/* Tessellation Shaders */
+
+static const char* const tessellation_vertex_source = R"VERTEX(
+#version 330 core
+
+layout(location = 0) in vec3 a_position;
+
+out vec3 patch_corner;
+
+void main()
+{
+	patch_corner = a_position;
+}
+)VERTEX";
+
+// Same as TerrainFacePoint in mesh_terrain.cpp, for the face coordinates and face in corner
+static const char* const face_point_source = R"FACEPOINT(
+vec3 FacePoint(vec3 corner)
+{
+	const vec3 axes[3] = vec3[3](vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1));
+	int face = int(corner.z + 0.5);
+	vec3 normal = axes[face / 2] * (face % 2 == 0 ? 1.0 : -1.0);
+	vec3 tangent = axes[(face / 2 + 1) % 3];
+	vec3 bitangent = axes[(face / 2 + 2) % 3];
+
+	vec3 cube = normal + corner.x * tangent + corner.y * bitangent;
+	return normalize(tan(cube * 0.785398163397));
+}
+)FACEPOINT";
+
+static const char* const tessellation_control_source = R"CONTROL(
+#version 330 core
+#extension GL_ARB_tessellation_shader : require
+
+layout(vertices = 4) out;
+
+in vec3 patch_corner[];
+out vec3 control_corner[];
+
+// See ObjectUniforms in uniform_buffers.h
+layout(std140) uniform ObjectUniforms
+{
+	mat4 u_model;
+	vec3 u_surface_color;
+	vec3 textured;
+};
+
+uniform vec3 u_camera_position;
+
+// Pixels covered by a length of 1 at a distance of 1
+uniform float u_pixels_per_unit;
+uniform float u_target_edge_pixels;
+uniform float u_max_level;
+
+vec3 FacePoint(vec3 corner);
+
+// Segments of the edge from the size on screen of the sphere around it. Only the edge decides,
+// so the patches on both of its sides split it the same way and no cracks open between them.
+float EdgeLevel(vec3 a, vec3 b)
+{
+	vec3 world_a = vec3(u_model * vec4(FacePoint(a), 1));
+	vec3 world_b = vec3(u_model * vec4(FacePoint(b), 1));
+	float camera_distance = max(distance((world_a + world_b) * 0.5, u_camera_position), 1e-4);
+	float pixels = distance(world_a, world_b) * u_pixels_per_unit / camera_distance;
+	return clamp(pixels / u_target_edge_pixels, 1, u_max_level);
+}
+
+void main()
+{
+	control_corner[gl_InvocationID] = patch_corner[gl_InvocationID];
+	if (gl_InvocationID != 0)
+		return;
+
+	// Outer levels are the edges u = 0, v = 0, u = 1 and v = 1, the corners are in the order of GL_QUADS
+	gl_TessLevelOuter[0] = EdgeLevel(patch_corner[0], patch_corner[3]);
+	gl_TessLevelOuter[1] = EdgeLevel(patch_corner[0], patch_corner[1]);
+	gl_TessLevelOuter[2] = EdgeLevel(patch_corner[1], patch_corner[2]);
+	gl_TessLevelOuter[3] = EdgeLevel(patch_corner[3], patch_corner[2]);
+	gl_TessLevelInner[0] = max(gl_TessLevelOuter[1], gl_TessLevelOuter[3]);
+	gl_TessLevelInner[1] = max(gl_TessLevelOuter[0], gl_TessLevelOuter[2]);
+}
+)CONTROL";
+
+static const char* const tessellation_evaluation_source = R"EVALUATION(
+#version 330 core
+#extension GL_ARB_tessellation_shader : require
+
+layout(quads, fractional_even_spacing, ccw) in;
+
+in vec3 control_corner[];
+
+// See FrameUniforms and ObjectUniforms in uniform_buffers.h
+layout(std140) uniform FrameUniforms
+{
+	mat4 u_projection_view;
+	vec2 u_mouse_position;
+	float u_time;
+};
+
+layout(std140) uniform ObjectUniforms
+{
+	mat4 u_model;
+	vec3 u_surface_color;
+	vec3 textured;
+};
+
+out vec4 world_space_position;
+out vec3 world_space_normal;
+out vec2 vertex_uv;
+out vec3 terrain_direction;
+flat out vec3 vertex_color;
+flat out vec3 vertex_textured;
+
+vec3 FacePoint(vec3 corner);
+
+void main()
+{
+	vec2 uv = gl_TessCoord.xy;
+	vec3 corner = mix(mix(control_corner[0], control_corner[1], uv.x), mix(control_corner[3], control_corner[2], uv.x), uv.y);
+	vec3 position = FacePoint(corner);
+
+	world_space_position = u_model * vec4(position, 1);
+	world_space_normal = vec3(u_model * vec4(position, 0));
+	vertex_uv = vec2(0);
+	terrain_direction = position;
+	vertex_color = u_surface_color;
+	vertex_textured = textured;
+
+	gl_Position = u_projection_view * world_space_position;
+}
+)EVALUATION";
+
+/* Helper Functions */
+
+// FacePoint is declared in the stages that use it and defined after them
+static std::string WithFacePoint(const char* source)
+{
+	return std::string(source) + face_point_source;
+}
+
+/* Tessellation Functions */
+bool TessellationSupported()
+{
+	return GLAD_GL_ARB_tessellation_shader;
+}
+
+TessellatedSphere CreateTessellatedSphere(const char* fragment_shader_source, int patches_per_face_edge)
+{
+	TessellatedSphere sphere = {};
+
+	auto control_source = WithFacePoint(tessellation_control_source);
+	auto evaluation_source = WithFacePoint(tessellation_evaluation_source);
+	sphere.program = CreateTessellationProgramFromSources(
+		tessellation_vertex_source, control_source.c_str(), evaluation_source.c_str(), fragment_shader_source);
+	if (sphere.program == 0)
+		return sphere;
+
+	GLint max_level = 0;
+	glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &max_level);
+	sphere.max_tessellation_level = glm::clamp(int(max_level), 1, max_tessellation_level);
+
+	BindUniformBlocks(sphere.program);
+	sphere.camera_position_location = glGetUniformLocation(sphere.program, "u_camera_position");
+	sphere.pixels_per_unit_location = glGetUniformLocation(sphere.program, "u_pixels_per_unit");
+	sphere.target_edge_pixels_location = glGetUniformLocation(sphere.program, "u_target_edge_pixels");
+	sphere.max_level_location = glGetUniformLocation(sphere.program, "u_max_level");
+
+	// Grid vertices of every face, shared by the patches of the face
+	auto grid = patches_per_face_edge + 1;
+	std::vector<glm::vec3> corners;
+	corners.reserve(size_t(6) * grid * grid);
+	for (int face = 0; face < 6; ++face)
+		for (int j = 0; j < grid; ++j)
+			for (int i = 0; i < grid; ++i)
+				corners.push_back(glm::vec3(glm::vec2(i, j) * 2.f / float(patches_per_face_edge) - 1.f, face));
+
+	std::vector<GLuint> indices;
+	sphere.occluder_radius = 1;
+	for (int face = 0; face < 6; ++face)
+		for (int j = 0; j < patches_per_face_edge; ++j)
+			for (int i = 0; i < patches_per_face_edge; ++i)
+			{
+				auto a = GLuint((face * grid + j) * grid + i);
+				MeshPatch patch;
+				patch.first_index = GLuint(indices.size());
+				patch.index_count = 4;
+				indices.insert(indices.end(), { a, a + 1, a + 1 + grid, a + grid });
+
+				// Bounds of the spherical cap, as for the terrain nodes. Two triangles of the
+				// corners are the coarsest tessellation, their normals tilt by up to angle.
+				auto center = TerrainFacePoint(face, glm::vec2(corners[a]) + 1.f / float(patches_per_face_edge));
+				float angle = 0;
+				for (auto index : { a, a + 1, a + 1 + grid, a + grid })
+					angle = glm::max(angle, glm::acos(glm::clamp(glm::dot(center, TerrainFacePoint(face, glm::vec2(corners[index]))), -1.f, 1.f)));
+
+				patch.center = center * glm::cos(angle);
+				patch.radius = glm::sin(angle);
+				patch.cone_axis = center;
+				patch.cone_angle = angle * 2;
+				sphere.patches.push_back(patch);
+				sphere.occluder_radius = glm::min(sphere.occluder_radius, glm::cos(angle));
+			}
+
+	glGenVertexArrays(1, &sphere.vao);
+	glBindVertexArray(sphere.vao);
+
+	glGenBuffers(1, &sphere.patch_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, sphere.patch_buffer);
+	glBufferData(GL_ARRAY_BUFFER, corners.size() * sizeof(glm::vec3), corners.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void*>(0));
+	glEnableVertexAttribArray(0);
+
+	glGenBuffers(1, &sphere.index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphere.index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+
+	glGenQueries(3, sphere.queries);
+	return sphere;
+}
+
+int DrawTessellatedSphere(
+	TessellatedSphere& sphere,
+	const glm::mat4& model,
+	const glm::mat4& projection_view,
+	const glm::vec3& camera_position,
+	float fov,
+	int viewport_height,
+	float target_edge_pixels
+)
+{
+	glUseProgram(sphere.program);
+	glUniform3fv(sphere.camera_position_location, 1, glm::value_ptr(camera_position));
+	glUniform1f(sphere.pixels_per_unit_location, viewport_height / (2 * glm::tan(fov / 2)));
+	glUniform1f(sphere.target_edge_pixels_location, target_edge_pixels);
+	glUniform1f(sphere.max_level_location, float(sphere.max_tessellation_level));
+
+	// Queries are read oldest first once they are ready. The next one is only begun again when its
+	// result has been read, beginning a pending query would throw the result away.
+	for (int i = 0; i < 3; ++i)
+	{
+		auto slot = (sphere.query_frame + i) % 3;
+		if (!sphere.query_pending[slot])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(sphere.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint triangles = 0;
+			glGetQueryObjectuiv(sphere.queries[slot], GL_QUERY_RESULT, &triangles);
+			sphere.triangles_generated = int(triangles);
+			sphere.query_pending[slot] = false;
+		}
+	}
+
+	GLuint query = 0;
+	if (!sphere.query_pending[sphere.query_frame])
+	{
+		query = sphere.queries[sphere.query_frame];
+		sphere.query_pending[sphere.query_frame] = true;
+		sphere.query_frame = (sphere.query_frame + 1) % 3;
+	}
+
+	CullMeshPatches(sphere.patches, model, projection_view, camera_position, sphere.occluder_radius, sphere.patch_counts, sphere.patch_offsets);
+
+	glBindVertexArray(sphere.vao);
+	glPatchParameteri(GL_PATCH_VERTICES, 4);
+	if (query != 0)
+		glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+	glMultiDrawElements(GL_PATCHES, sphere.patch_counts.data(), GL_UNSIGNED_INT, sphere.patch_offsets.data(), GLsizei(sphere.patch_counts.size()));
+	if (query != 0)
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+
+	return sphere.triangles_generated;
+}
\ No newline at end of file
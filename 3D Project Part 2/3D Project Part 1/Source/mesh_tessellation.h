@@ -0,0 +1,71 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "mesh_culling.h"
+
+/* Tessellation Structs */
+
+// The unit sphere as quad patches over the six faces of a cube, patches_per_face_edge by
+// patches_per_face_edge per face. Patches are culled on the CPU like the patches of the cached
+// meshes, the tessellation control shader splits every patch edge by its size on screen and the
+// evaluation shader puts the vertices on the sphere with the equal angle projection of the terrain,
+// so no vertex of the sphere is ever stored. Attribute 0 of the patch corners is the face
+// coordinates and the face, every patch is four indices.
+struct TessellatedSphere
+{
+	GLuint program;
+	GLuint vao;
+	GLuint patch_buffer;
+	GLuint index_buffer;
+	int max_tessellation_level;
+
+	// Bounds of every patch, and the radius of a sphere inside even the coarsest tessellation
+	std::vector<MeshPatch> patches;
+	float occluder_radius;
+
+	// Visible index ranges of the last draw
+	std::vector<GLsizei> patch_counts;
+	std::vector<const void*> patch_offsets;
+
+	// GL_PRIMITIVES_GENERATED of the last frames, read once the GPU is done with them so the CPU does not wait.
+	// query_frame is the next query to begin, a frame whose query is still pending draws without one.
+	GLuint queries[3];
+	bool query_pending[3];
+	int query_frame;
+	int triangles_generated;
+
+	GLint camera_position_location;
+	GLint pixels_per_unit_location;
+	GLint target_edge_pixels_location;
+	GLint max_level_location;
+};
+
+/* Tessellation Functions */
+
+// Needs GL 4.0 or ARB_tessellation_shader
+bool TessellationSupported();
+
+// The fragment shader is linked after the tessellation stages, which pass it world_space_position,
+// world_space_normal, terrain_direction (the mesh space position), a vertex_uv of zero, and the
+// u_surface_color and textured object uniforms as the flat vertex_color and vertex_textured, the
+// same outputs as the terrain vertex layout. Returns a program of 0 when the shaders fail to build.
+TessellatedSphere CreateTessellatedSphere(const char* fragment_shader_source, int patches_per_face_edge = 8);
+
+// Uses the program and draws the sphere with edges of about target_edge_pixels, for a perspective
+// projection of the fov on a viewport viewport_height pixels high. The model may rotate and translate
+// but only scale uniformly. The shaders read the model and projection_view from the bound
+// ObjectUniforms and FrameUniforms, these only cull the patches. Returns the triangles generated by the latest draw the GPU has finished,
+// a few frames behind.
+int DrawTessellatedSphere(
+	TessellatedSphere& sphere,
+	const glm::mat4& model,
+	const glm::mat4& projection_view,
+	const glm::vec3& camera_position,
+	float fov,
+	int viewport_height,
+	float target_edge_pixels = 8
+);
\ No newline at end of file
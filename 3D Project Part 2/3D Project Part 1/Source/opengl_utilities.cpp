@@ -1,99 +1,297 @@
 #include "opengl_utilities.h"
 
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+
 /* OpenGL Utility Structs */
 
 VAO::VAO(
 	const std::vector<glm::vec3>& positions,
 	const std::vector<glm::vec3>& normals,
 	const std::vector<glm::vec2>& uvs,
-	const std::vector<GLuint>& indices
+	const std::vector<GLuint>& indices,
+	VertexLayout layout
 )
 {
+	VertexData data = {};
+	data.layout = layout;
+	data.vertex_count = GLsizei(positions.size());
+	data.index_count = GLsizei(indices.size());
+	data.indices = indices.data();
+
+	std::vector<QuantizedVertex> vertices;
+	if (layout == VertexLayout::Separate)
+	{
+		data.positions = positions.data();
+		data.normals = normals.data();
+		data.uvs = uvs.data();
+	}
+	else
+	{
+		vertices = QuantizeVertices(positions, normals, uvs, data.position_scale, data.position_offset);
+		data.quantized_vertices = vertices.data();
+	}
+
+	Upload(data);
+};
+
+VAO::VAO(const VertexData& data)
+{
+	Upload(data);
+};
+
+void VAO::Upload(const VertexData& data)
+{
+	layout = data.layout;
+	position_buffer = 0;
+	normals_buffer = 0;
+	uv_buffer = 0;
+	interleaved_buffer = 0;
+	position_scale = glm::vec3(1);
+	position_offset = glm::vec3(0);
+
 	glGenVertexArrays(1, &id);
 	glBindVertexArray(id);
 
-	vertex_count = GLsizei(positions.size());
+	vertex_count = data.vertex_count;
 
-	glGenBuffers(1, &position_buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, position_buffer);
-	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+	if (layout == VertexLayout::Separate)
+	{
+		glGenBuffers(1, &position_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, position_buffer);
+		glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(glm::vec3), data.positions, GL_STATIC_DRAW);
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
+		glEnableVertexAttribArray(0);
+
+
+		glGenBuffers(1, &normals_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, normals_buffer);
+		glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(glm::vec3), data.normals, GL_STATIC_DRAW);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
-	glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
+		glEnableVertexAttribArray(1);
 
+		glGenBuffers(1, &uv_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, uv_buffer);
+		glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(glm::vec2), data.uvs, GL_STATIC_DRAW);
+
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, static_cast<void*>(0));
+		glEnableVertexAttribArray(2);
+	}
+	else
+	{
+		position_scale = data.position_scale;
+		position_offset = data.position_offset;
 
-	glGenBuffers(1, &normals_buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, normals_buffer);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
+		glGenBuffers(1, &interleaved_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, interleaved_buffer);
+		glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(QuantizedVertex), data.quantized_vertices, GL_STATIC_DRAW);
 
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
-	glEnableVertexAttribArray(1);
+		auto stride = GLsizei(sizeof(QuantizedVertex));
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(QuantizedVertex, position)));
+		glEnableVertexAttribArray(0);
 
-	glGenBuffers(1, &uv_buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, uv_buffer);
-	glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), uvs.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(QuantizedVertex, normal)));
+		glEnableVertexAttribArray(1);
 
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, static_cast<void*>(0));
-	glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(offsetof(QuantizedVertex, uv)));
+		glEnableVertexAttribArray(2);
+	}
 
 
-	element_array_count = GLsizei(indices.size());
+	element_array_count = data.index_count;
 
 	glGenBuffers(1, &element_array_buffer);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-};
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, element_array_count * sizeof(GLuint), data.indices, GL_STATIC_DRAW);
+}
 
-/* OpenGL Utility Functions */
-GLuint CreateShaderFromSource(const GLenum& shader_type, const GLchar * source)
+/* Helper Functions */
+
+// Links the shaders into a program, NULL when a shader did not compile or linking failed.
+// The shaders are deleted, the program keeps them until it is deleted itself.
+static GLuint LinkProgram(std::initializer_list<GLuint> shaders)
 {
-	GLuint shader = glCreateShader(shader_type);
-	glShaderSource(shader, 1, &source, NULL);
-	glCompileShader(shader);
+	for (auto shader : shaders)
+		if (shader == NULL)
+		{
+			for (auto compiled : shaders)
+				if (compiled != NULL)
+					glDeleteShader(compiled);
+			return NULL;
+		}
+
+	GLuint program = glCreateProgram();
+	for (auto shader : shaders)
+	{
+		glAttachShader(program, shader);
+		glDeleteShader(shader);
+	}
+	glLinkProgram(program);
 
 	int success;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
 	if (!success)
 	{
-		std::cout << "Error: Shader Compilation failed" << std::endl;
+		std::cout << "Error: Program Linking failed" << std::endl;
 
 		char info_log[512];
-		glGetShaderInfoLog(shader, 512, NULL, info_log);
+		glGetProgramInfoLog(program, 512, NULL, info_log);
 		std::cout << info_log << std::endl;
 
-		glDeleteShader(shader);
+		glDeleteProgram(program);
 		return NULL;
 	}
 
-	return shader;
+	return program;
 }
 
-GLuint CreateProgramFromSources(const GLchar * vertex_shader_source, const GLchar * fragment_shader_source)
+/* OpenGL Utility Functions */
+std::vector<QuantizedVertex> QuantizeVertices(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& uvs,
+	glm::vec3& position_scale,
+	glm::vec3& position_offset
+)
 {
-	GLuint vertex_shader = CreateShaderFromSource(GL_VERTEX_SHADER, vertex_shader_source);
-	GLuint fragment_shader = CreateShaderFromSource(GL_FRAGMENT_SHADER, fragment_shader_source);
+	auto min_position = glm::vec3(std::numeric_limits<float>::max());
+	auto max_position = glm::vec3(std::numeric_limits<float>::lowest());
+	for (auto& position : positions)
+	{
+		min_position = glm::min(min_position, position);
+		max_position = glm::max(max_position, position);
+	}
 
-	if (vertex_shader == NULL || fragment_shader == NULL)
-		return NULL;
+	QuantizationBounds(min_position, max_position, position_scale, position_offset);
 
-	GLuint program = glCreateProgram();
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
-	glLinkProgram(program);
+	std::vector<QuantizedVertex> vertices(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i)
+		vertices[i] = QuantizeVertex(positions[i], normals[i], uvs[i], position_scale, position_offset);
+
+	return vertices;
+}
+
+void QuantizationBounds(
+	const glm::vec3& min_position,
+	const glm::vec3& max_position,
+	glm::vec3& position_scale,
+	glm::vec3& position_offset
+)
+{
+	// Flat meshes would otherwise divide by zero
+	position_offset = min_position;
+	position_scale = glm::max(max_position - min_position, glm::vec3(std::numeric_limits<float>::min()));
+}
+
+QuantizedVertex QuantizeVertex(
+	const glm::vec3& position,
+	const glm::vec3& normal,
+	const glm::vec2& uv,
+	const glm::vec3& position_scale,
+	const glm::vec3& position_offset
+)
+{
+	auto to_unorm16 = [](float value)
+	{
+		return GLushort(glm::round(glm::clamp(value, 0.f, 1.f) * 65535.f));
+	};
+	auto to_snorm16 = [](float value)
+	{
+		return GLshort(glm::round(glm::clamp(value, -1.f, 1.f) * 32767.f));
+	};
+
+	auto unit_position = (position - position_offset) / position_scale;
+	auto encoded_normal = OctahedralEncode(normal);
+
+	QuantizedVertex vertex;
+	vertex.position[0] = to_unorm16(unit_position.x);
+	vertex.position[1] = to_unorm16(unit_position.y);
+	vertex.position[2] = to_unorm16(unit_position.z);
+	vertex.position[3] = 0;
+	vertex.normal[0] = to_snorm16(encoded_normal.x);
+	vertex.normal[1] = to_snorm16(encoded_normal.y);
+	vertex.uv[0] = to_unorm16(uv.x / quantized_uv_range.x);
+	vertex.uv[1] = to_unorm16(uv.y / quantized_uv_range.y);
+	return vertex;
+}
+
+glm::vec2 DequantizeUV(const QuantizedVertex& vertex)
+{
+	return glm::vec2(vertex.uv[0], vertex.uv[1]) / 65535.f * quantized_uv_range;
+}
+
+// Projects the unit sphere onto an octahedron and unfolds it to [-1, 1]^2
+glm::vec2 OctahedralEncode(const glm::vec3& normal)
+{
+	auto n = normal / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+	auto encoded = glm::vec2(n.x, n.y);
+	if (n.z < 0)
+	{
+		auto sign = glm::vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+		encoded = (1.f - glm::abs(glm::vec2(n.y, n.x))) * sign;
+	}
+	return encoded;
+}
+
+glm::vec3 OctahedralDecode(const glm::vec2& encoded)
+{
+	auto normal = glm::vec3(encoded, 1 - glm::abs(encoded.x) - glm::abs(encoded.y));
+	auto fold = glm::max(-normal.z, 0.f);
+	normal.x += normal.x >= 0 ? -fold : fold;
+	normal.y += normal.y >= 0 ? -fold : fold;
+	return glm::normalize(normal);
+}
+
+GLuint CreateShaderFromSource(const GLenum& shader_type, const GLchar * source)
+{
+	GLuint shader = glCreateShader(shader_type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
 
 	int success;
-	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 	if (!success)
 	{
-		std::cout << "Error: Program Linking failed" << std::endl;
+		std::cout << "Error: Shader Compilation failed" << std::endl;
 
 		char info_log[512];
-		glGetProgramInfoLog(program, 512, NULL, info_log);
+		glGetShaderInfoLog(shader, 512, NULL, info_log);
 		std::cout << info_log << std::endl;
 
-		glDeleteProgram(program);
+		glDeleteShader(shader);
 		return NULL;
 	}
 
-	return program;
+	return shader;
+}
+
+GLuint CreateProgramFromSources(const GLchar * vertex_shader_source, const GLchar * fragment_shader_source)
+{
+	return LinkProgram({
+		CreateShaderFromSource(GL_VERTEX_SHADER, vertex_shader_source),
+		CreateShaderFromSource(GL_FRAGMENT_SHADER, fragment_shader_source)
+	});
+}
+
+GLuint CreateComputeProgramFromSource(const GLchar * compute_shader_source)
+{
+	return LinkProgram({ CreateShaderFromSource(GL_COMPUTE_SHADER, compute_shader_source) });
+}
+
+GLuint CreateTessellationProgramFromSources(
+	const GLchar * vertex_shader_source,
+	const GLchar * tessellation_control_shader_source,
+	const GLchar * tessellation_evaluation_shader_source,
+	const GLchar * fragment_shader_source
+)
+{
+	return LinkProgram({
+		CreateShaderFromSource(GL_VERTEX_SHADER, vertex_shader_source),
+		CreateShaderFromSource(GL_TESS_CONTROL_SHADER, tessellation_control_shader_source),
+		CreateShaderFromSource(GL_TESS_EVALUATION_SHADER, tessellation_evaluation_shader_source),
+		CreateShaderFromSource(GL_FRAGMENT_SHADER, fragment_shader_source)
+	});
 }
\ No newline at end of file
@@ -6,16 +6,65 @@
 #include "GLAD/glad.h"
 #include "GLM/glm.hpp"
 
+/* OpenGL Utility Constants */
+
+// Range of the quantized uvs, u reaches up to 2 on the copies of seam vertices at u + 1.
+// The vertex shader scales a_uv of quantized meshes back by it.
+static const glm::vec2 quantized_uv_range = glm::vec2(2, 1);
+
 /* OpenGL Utility Structs */
 
+// Separate: float position, normal and uv buffers, 32 bytes per vertex
+// InterleavedQuantized: a single buffer of QuantizedVertex, 16 bytes per vertex
+enum class VertexLayout
+{
+	Separate,
+	InterleavedQuantized
+};
+
+// Position is 16 bit unorm relative to the mesh bounds, normal is 16 bit snorm
+// octahedral encoded, uv is 16 bit unorm of uv / quantized_uv_range. position[3] is padding.
+struct QuantizedVertex
+{
+	GLushort position[4];
+	GLshort normal[2];
+	GLushort uv[2];
+};
+
+// Vertex and index data in the layout it is uploaded in, so it can point straight into
+// a memory mapped file. Separate uses positions, normals and uvs, InterleavedQuantized
+// uses quantized_vertices with position_scale and position_offset.
+struct VertexData
+{
+	VertexLayout layout;
+	GLsizei vertex_count;
+	GLsizei index_count;
+
+	const glm::vec3* positions;
+	const glm::vec3* normals;
+	const glm::vec2* uvs;
+
+	const QuantizedVertex* quantized_vertices;
+	glm::vec3 position_scale;
+	glm::vec3 position_offset;
+
+	const GLuint* indices;
+};
+
 struct VAO
 {
 	GLuint id;
+	VertexLayout layout;
 
 	GLsizei vertex_count;
 	GLuint position_buffer;
 	GLuint normals_buffer;
 	GLuint uv_buffer;
+	GLuint interleaved_buffer;
+
+	// Decoded position is a_position * position_scale + position_offset
+	glm::vec3 position_scale;
+	glm::vec3 position_offset;
 
 	GLsizei element_array_count;
 	GLuint element_array_buffer;
@@ -24,13 +73,63 @@ struct VAO
 		const std::vector<glm::vec3>& positions,
 		const std::vector<glm::vec3>& normals,
 		const std::vector<glm::vec2>& uvs,
-		const std::vector<GLuint>& indices
+		const std::vector<GLuint>& indices,
+		VertexLayout layout = VertexLayout::Separate
 	);
+
+	VAO(const VertexData& data);
+
+private:
+	void Upload(const VertexData& data);
 };
 
 /* OpenGL Utility Functions */
 
+std::vector<QuantizedVertex> QuantizeVertices(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<glm::vec2>& uvs,
+	glm::vec3& position_scale,
+	glm::vec3& position_offset
+);
+
+// Scale and offset that map [min_position, max_position] to the unorm range of QuantizedVertex
+void QuantizationBounds(
+	const glm::vec3& min_position,
+	const glm::vec3& max_position,
+	glm::vec3& position_scale,
+	glm::vec3& position_offset
+);
+
+// Positions outside the bounds are clamped to them
+QuantizedVertex QuantizeVertex(
+	const glm::vec3& position,
+	const glm::vec3& normal,
+	const glm::vec2& uv,
+	const glm::vec3& position_scale,
+	const glm::vec3& position_offset
+);
+
+// Texture coordinates of a quantized vertex, same as the vertex shader decodes them
+glm::vec2 DequantizeUV(const QuantizedVertex& vertex);
+
+glm::vec2 OctahedralEncode(const glm::vec3& normal);
+
+// Inverse of OctahedralEncode, same as OctahedralDecode in the vertex shader
+glm::vec3 OctahedralDecode(const glm::vec2& encoded);
+
 GLuint CreateShaderFromSource(const GLenum& shader_type, const GLchar * source);
 
 GLuint CreateProgramFromSources(const GLchar * vertex_shader_source, const GLchar * fragment_shader_source);
 
+// Needs GL 4.3 or ARB_compute_shader
+GLuint CreateComputeProgramFromSource(const GLchar * compute_shader_source);
+
+// Needs GL 4.0 or ARB_tessellation_shader
+GLuint CreateTessellationProgramFromSources(
+	const GLchar * vertex_shader_source,
+	const GLchar * tessellation_control_shader_source,
+	const GLchar * tessellation_evaluation_shader_source,
+	const GLchar * fragment_shader_source
+);
+
@@ -0,0 +1,191 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <cstring>
+#include "GLM/gtc/type_ptr.hpp"
+
+/* Helper Functions */
+
+static void SendUniform(GLint location, const glm::vec3& value)
+{
+	glUniform3fv(location, 1, glm::value_ptr(value));
+}
+
+static void SendUniform(GLint location, int value)
+{
+	glUniform1i(location, value);
+}
+
+static bool SameObject(const ObjectUniforms& first, const ObjectUniforms& second)
+{
+	return first.model == second.model && first.surface_color == second.surface_color && first.textured == second.textured;
+}
+
+// Sends the value unless the program has it already
+template <typename T>
+static void UpdateUniform(GLint location, const T& value, const T& sent, bool known, RenderQueueCounters& counters)
+{
+	if (location < 0)
+		return;
+	if (known && value == sent)
+	{
+		++counters.uniform_uploads_skipped;
+		return;
+	}
+	SendUniform(location, value);
+	++counters.uniform_uploads;
+}
+
+/* Render Queue Functions */
+RenderQueue CreateRenderQueue(int object_slots)
+{
+	RenderQueue queue;
+	queue.object_ring = CreateObjectUniformRing(object_slots);
+	queue.counters = {};
+	return queue;
+}
+
+void RegisterRenderQueueProgram(RenderQueue& queue, GLuint program, bool queue_uniforms)
+{
+	RenderQueueProgram locations = { -1, -1, -1, -1, -1 };
+	if (queue_uniforms)
+	{
+		locations.vertex_layout_location = glGetUniformLocation(program, "u_vertex_layout");
+		locations.position_scale_location = glGetUniformLocation(program, "u_position_scale");
+		locations.position_offset_location = glGetUniformLocation(program, "u_position_offset");
+		locations.instanced_location = glGetUniformLocation(program, "u_instanced");
+		locations.indirect_location = glGetUniformLocation(program, "u_indirect");
+	}
+	queue.programs[program] = locations;
+	queue.program_uniforms.erase(program);
+}
+
+std::uint64_t RenderSortKey(GLuint program, GLuint vao, GLuint texture, float depth)
+{
+	// Non-negative floats sort like their bits
+	std::uint32_t depth_bits;
+	depth = glm::max(depth, 0.f);
+	std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+	return (std::uint64_t(program & 0xff) << 56) | (std::uint64_t(vao & 0xffff) << 40)
+		| (std::uint64_t(texture & 0xff) << 32) | depth_bits;
+}
+
+DrawPacket CreateDrawPacket(GLuint program, GLuint vao, GLuint texture, float depth, const std::function<void()>& draw)
+{
+	DrawPacket packet;
+	packet.sort_key = RenderSortKey(program, vao, texture, depth);
+	packet.program = program;
+	packet.vao = vao;
+	packet.texture = texture;
+	packet.uniforms.model = glm::mat4(1);
+	packet.uniforms.surface_color = glm::vec3(1);
+	packet.uniforms.textured = glm::vec3(0);
+	packet.uniforms.vertex_layout = 0;
+	packet.uniforms.position_scale = glm::vec3(1);
+	packet.uniforms.position_offset = glm::vec3(0);
+	packet.uniforms.instanced = 0;
+	packet.uniforms.indirect = 0;
+	packet.draw = draw;
+	return packet;
+}
+
+void SubmitDrawPacket(RenderQueue& queue, DrawPacket packet)
+{
+	queue.packets.push_back(std::move(packet));
+}
+
+RenderQueueCounters ExecuteRenderQueue(RenderQueue& queue)
+{
+	RenderQueueCounters counters = {};
+	counters.packets = int(queue.packets.size());
+
+	// Packets of the same key keep the order they were submitted in
+	queue.order.clear();
+	for (size_t i = 0; i < queue.packets.size(); ++i)
+		queue.order.push_back(std::make_pair(queue.packets[i].sort_key, i));
+	std::sort(queue.order.begin(), queue.order.end());
+
+	// Packets with the same object uniforms as the packet before share its slot
+	queue.objects.clear();
+	queue.object_slots.clear();
+	for (auto& entry : queue.order)
+	{
+		auto& wanted = queue.packets[entry.second].uniforms;
+		ObjectUniforms object = { wanted.model, wanted.surface_color, 0, wanted.textured, 0 };
+		if (queue.objects.empty() || !SameObject(object, queue.objects.back()))
+			queue.objects.push_back(object);
+		else
+			++counters.object_slots_shared;
+		queue.object_slots.push_back(int(queue.objects.size()) - 1);
+	}
+	if (!WriteObjectUniforms(queue.object_ring, queue.objects))
+	{
+		UploadObjectUniforms(queue.object_ring, queue.objects);
+		counters.object_slots_uploaded = int(queue.objects.size());
+	}
+	counters.object_slots = int(queue.objects.size());
+
+	// Whatever is bound before the first packet is not known
+	GLuint program = 0;
+	GLuint vao = 0;
+	GLuint texture = 0;
+	auto first = true;
+	for (size_t i = 0; i < queue.order.size(); ++i)
+	{
+		auto& packet = queue.packets[queue.order[i].second];
+
+		if (!first && packet.program == program)
+			++counters.program_binds_skipped;
+		else
+		{
+			glUseProgram(packet.program);
+			program = packet.program;
+			++counters.program_binds;
+		}
+
+		if (!first && packet.vao == vao)
+			++counters.vao_binds_skipped;
+		else
+		{
+			glBindVertexArray(packet.vao);
+			vao = packet.vao;
+			++counters.vao_binds;
+		}
+
+		if (packet.texture != 0 && packet.texture == texture)
+			++counters.texture_binds_skipped;
+		else if (packet.texture != 0)
+		{
+			glBindTexture(GL_TEXTURE_2D, packet.texture);
+			texture = packet.texture;
+			++counters.texture_binds;
+		}
+
+		if (first || queue.object_slots[i] != queue.object_slots[i - 1])
+			BindObjectUniforms(queue.object_ring, queue.object_slots[i]);
+		first = false;
+
+		auto locations = queue.programs.find(packet.program);
+		if (locations != queue.programs.end())
+		{
+			auto& l = locations->second;
+			auto known = queue.program_uniforms.count(packet.program) != 0;
+			auto& sent = queue.program_uniforms[packet.program];
+			auto& wanted = packet.uniforms;
+			UpdateUniform(l.vertex_layout_location, wanted.vertex_layout, sent.vertex_layout, known, counters);
+			UpdateUniform(l.position_scale_location, wanted.position_scale, sent.position_scale, known, counters);
+			UpdateUniform(l.position_offset_location, wanted.position_offset, sent.position_offset, known, counters);
+			UpdateUniform(l.instanced_location, wanted.instanced, sent.instanced, known, counters);
+			UpdateUniform(l.indirect_location, wanted.indirect, sent.indirect, known, counters);
+			sent = wanted;
+		}
+
+		packet.draw();
+	}
+	FenceObjectUniforms(queue.object_ring);
+
+	queue.packets.clear();
+	queue.counters = counters;
+	return counters;
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "uniform_buffers.h"
+
+/* Render Queue Structs */
+
+// Locations of the per draw uniforms of a program, -1 for those it does not have or sets itself.
+// Model, surface color and textured are in the ObjectUniforms block of every program instead.
+struct RenderQueueProgram
+{
+	GLint vertex_layout_location;
+	GLint position_scale_location;
+	GLint position_offset_location;
+	GLint instanced_location;
+	GLint indirect_location;
+};
+
+// Values of the per draw uniforms and object uniforms, as last sent to a program or as wanted by a packet
+struct RenderQueueUniforms
+{
+	glm::mat4 model;
+	glm::vec3 surface_color;
+	glm::vec3 textured;
+	int vertex_layout;
+	glm::vec3 position_scale;
+	glm::vec3 position_offset;
+	int instanced;
+	int indirect;
+};
+
+// A draw with the state it needs. The queue uses the program, binds the VAO, the texture on
+// texture unit 0 and the slot of the object uniforms and sets the uniforms that changed, then
+// calls draw for the draw calls and the uniforms only this draw has. draw may bind the packet's
+// VAO again, but no other.
+struct DrawPacket
+{
+	std::uint64_t sort_key;
+	GLuint program;
+	GLuint vao;
+
+	// 0 leaves the bound texture, for draws that do not sample it
+	GLuint texture;
+
+	RenderQueueUniforms uniforms;
+	std::function<void()> draw;
+};
+
+// State changes of the last ExecuteRenderQueue, and those skipped because the state was set already
+struct RenderQueueCounters
+{
+	int packets;
+	int program_binds;
+	int program_binds_skipped;
+	int vao_binds;
+	int vao_binds_skipped;
+	int texture_binds;
+	int texture_binds_skipped;
+	int uniform_uploads;
+	int uniform_uploads_skipped;
+
+	// Slots of the object uniform ring written, packets that shared the slot of the packet before,
+	// and slots written by glBufferSubData because the ring could not be mapped
+	int object_slots;
+	int object_slots_shared;
+	int object_slots_uploaded;
+};
+
+// Packets of a frame, executed in the order of their sort keys, which puts draws that share a
+// program, VAO and texture next to each other and sorts them front to back
+struct RenderQueue
+{
+	std::vector<DrawPacket> packets;
+	std::vector<std::pair<std::uint64_t, size_t>> order;
+
+	std::unordered_map<GLuint, RenderQueueProgram> programs;
+
+	// Uniforms are state of the program, so they are known across frames
+	std::unordered_map<GLuint, RenderQueueUniforms> program_uniforms;
+
+	// Object uniforms of the frame in the order of the packets, and the slot of every packet
+	ObjectUniformRing object_ring;
+	std::vector<ObjectUniforms> objects;
+	std::vector<int> object_slots;
+
+	RenderQueueCounters counters;
+};
+
+/* Render Queue Functions */
+
+// The object uniform ring starts with object_slots slots per frame
+RenderQueue CreateRenderQueue(int object_slots = 256);
+
+// Looks up the per draw uniforms by name. Without queue_uniforms the program's draws set all their uniforms themselves.
+void RegisterRenderQueueProgram(RenderQueue& queue, GLuint program, bool queue_uniforms = true);
+
+// Program, VAO and texture from the most to the least significant bits, then the distance from the
+// camera. Only the low bits of the GL names are kept, which only ever costs a state change.
+std::uint64_t RenderSortKey(GLuint program, GLuint vao, GLuint texture, float depth);
+
+// An untextured packet of the identity model and white surface, uniforms as for VertexLayout::Separate
+DrawPacket CreateDrawPacket(GLuint program, GLuint vao, GLuint texture, float depth, const std::function<void()>& draw);
+
+void SubmitDrawPacket(RenderQueue& queue, DrawPacket packet);
+
+// Sorts and draws the submitted packets and clears the queue. The object uniforms of all packets are
+// written with one map of the ring. The programs' uniforms must only be changed through the queue
+// since the last execution, the bound program, VAO, texture and object uniforms may be anything.
+RenderQueueCounters ExecuteRenderQueue(RenderQueue& queue);
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "uniform_buffers.h"
+
+#include <cstring>
+
+/* Uniform Buffer Constants */
+
+static const GLuint frame_uniform_binding = 0;
+static const GLuint object_uniform_binding = 1;
+static const GLuint indirect_draw_binding = 2;
+
+// glUnmapBuffer reports a lost data store, e.g. after a display mode change, the objects are written again then
+static const int max_map_attempts = 3;
+
+/* Helper Functions */
+
+static void BindUniformBlock(GLuint program, const char* name, GLuint binding)
+{
+	auto index = glGetUniformBlockIndex(program, name);
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, index, binding);
+}
+
+// Waits for the draws of the frame that last used the region
+static void WaitForRegion(ObjectUniformRing& ring, int frame)
+{
+	auto& fence = ring.fences[frame];
+	if (fence == nullptr)
+		return;
+	while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+		;
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+static void AllocateObjectUniformRing(ObjectUniformRing& ring)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+	glBufferData(GL_UNIFORM_BUFFER, ring.slot_stride * ring.slot_count * ring.frame_count, nullptr, GL_STREAM_DRAW);
+}
+
+/* Uniform Buffer Functions */
+void BindUniformBlocks(GLuint program)
+{
+	BindUniformBlock(program, "FrameUniforms", frame_uniform_binding);
+	BindUniformBlock(program, "ObjectUniforms", object_uniform_binding);
+	BindUniformBlock(program, "IndirectDraws", indirect_draw_binding);
+}
+
+GLuint CreateFrameUniformBuffer()
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_STREAM_DRAW);
+	return buffer;
+}
+
+void UploadFrameUniforms(GLuint buffer, const FrameUniforms& uniforms)
+{
+	// A new store every frame, so the driver does not wait for the draws of the last one
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), &uniforms, GL_STREAM_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, frame_uniform_binding, buffer);
+}
+
+ObjectUniformRing CreateObjectUniformRing(int slot_count, int frame_count)
+{
+	GLint alignment = 1;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment = glm::max(alignment, 1);
+
+	ObjectUniformRing ring = {};
+	ring.slot_stride = (GLsizeiptr(sizeof(ObjectUniforms)) + alignment - 1) / alignment * alignment;
+	ring.slot_count = glm::max(slot_count, 1);
+	ring.frame_count = glm::max(frame_count, 1);
+	ring.fences.resize(ring.frame_count, nullptr);
+
+	glGenBuffers(1, &ring.buffer);
+	AllocateObjectUniformRing(ring);
+	return ring;
+}
+
+bool WriteObjectUniforms(ObjectUniformRing& ring, const std::vector<ObjectUniforms>& objects)
+{
+	if (objects.empty())
+		return true;
+
+	// Every region is in use by some frame, so they all have to be done before the buffer is replaced
+	if (int(objects.size()) > ring.slot_count)
+	{
+		for (int frame = 0; frame < ring.frame_count; ++frame)
+			WaitForRegion(ring, frame);
+		ring.slot_count = glm::max(int(objects.size()), ring.slot_count * 2);
+		AllocateObjectUniformRing(ring);
+	}
+	WaitForRegion(ring, ring.frame);
+
+	// The fence is passed, so the GPU is done with the region and it can be written without synchronizing
+	auto offset = ring.slot_stride * ring.slot_count * ring.frame;
+	auto size = ring.slot_stride * GLsizeiptr(objects.size());
+	glBindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+	for (int attempt = 0; attempt < max_map_attempts; ++attempt)
+	{
+		auto mapping = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		if (mapping == nullptr)
+			return false;
+
+		for (size_t i = 0; i < objects.size(); ++i)
+			std::memcpy(mapping + ring.slot_stride * i, &objects[i], sizeof(ObjectUniforms));
+		if (glUnmapBuffer(GL_UNIFORM_BUFFER) == GL_TRUE)
+			return true;
+	}
+	return false;
+}
+
+void UploadObjectUniforms(ObjectUniformRing& ring, const std::vector<ObjectUniforms>& objects)
+{
+	// WriteObjectUniforms already made room for the objects and waited for the region
+	auto offset = ring.slot_stride * ring.slot_count * ring.frame;
+	glBindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+	for (size_t i = 0; i < objects.size(); ++i)
+		glBufferSubData(GL_UNIFORM_BUFFER, offset + ring.slot_stride * GLsizeiptr(i), sizeof(ObjectUniforms), &objects[i]);
+}
+
+void BindObjectUniforms(const ObjectUniformRing& ring, int slot)
+{
+	auto offset = ring.slot_stride * (GLsizeiptr(ring.slot_count) * ring.frame + slot);
+	glBindBufferRange(GL_UNIFORM_BUFFER, object_uniform_binding, ring.buffer, offset, sizeof(ObjectUniforms));
+}
+
+void FenceObjectUniforms(ObjectUniformRing& ring)
+{
+	// A frame without objects did not wait for the last fence, the new one passes after it anyway
+	auto& fence = ring.fences[ring.frame];
+	if (fence != nullptr)
+		glDeleteSync(fence);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	ring.frame = (ring.frame + 1) % ring.frame_count;
+}
+
+void BindIndirectDrawData(GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, indirect_draw_binding, buffer, offset, size);
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/* Uniform Buffer Structs */
+
+// std140 layout of the FrameUniforms block, data that is the same for every draw of a frame
+struct FrameUniforms
+{
+	glm::mat4 projection_view;
+	glm::vec2 mouse_position;
+	float time;
+	float padding;
+};
+
+// std140 layout of the ObjectUniforms block, a vec3 is aligned like a vec4
+struct ObjectUniforms
+{
+	glm::mat4 model;
+	glm::vec3 surface_color;
+	float padding0;
+	glm::vec3 textured;
+	float padding1;
+};
+
+// One buffer of frame_count regions of slot_count ObjectUniforms each. A frame writes the objects of
+// all its draws to its region with a single map, and every draw binds the range of its slot. A region
+// is only written again once the GPU has passed the fence of the frame that last used it.
+struct ObjectUniformRing
+{
+	GLuint buffer;
+
+	// sizeof(ObjectUniforms) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	GLsizeiptr slot_stride;
+	int slot_count;
+	int frame_count;
+	int frame;
+	std::vector<GLsync> fences;
+};
+
+/* Uniform Buffer Functions */
+
+// Points the FrameUniforms, ObjectUniforms and IndirectDraws blocks of the program, those it has, to their binding points
+void BindUniformBlocks(GLuint program);
+
+GLuint CreateFrameUniformBuffer();
+
+// Replaces the contents of the buffer and binds it to the FrameUniforms binding point
+void UploadFrameUniforms(GLuint buffer, const FrameUniforms& uniforms);
+
+ObjectUniformRing CreateObjectUniformRing(int slot_count = 256, int frame_count = 3);
+
+// Writes the objects to the slots of this frame's region, waiting for the GPU to finish the frame
+// that used it last. The ring grows when there are more objects than slots. Returns false when the
+// region could not be mapped, or its data store was lost every time, and the slots were not written.
+bool WriteObjectUniforms(ObjectUniformRing& ring, const std::vector<ObjectUniforms>& objects);
+
+// Writes the objects to the slots of this frame's region with glBufferSubData, for when
+// WriteObjectUniforms failed, which has made room for them already
+void UploadObjectUniforms(ObjectUniformRing& ring, const std::vector<ObjectUniforms>& objects);
+
+// Binds the slot of this frame's region to the ObjectUniforms binding point
+void BindObjectUniforms(const ObjectUniformRing& ring, int slot);
+
+// Fences the draws of this frame, call after the last draw that uses its slots
+void FenceObjectUniforms(ObjectUniformRing& ring);
+
+// Binds size bytes of the buffer from offset to the IndirectDraws binding point, see mesh_indirect.h
+void BindIndirectDrawData(GLuint buffer, GLintptr offset, GLsizeiptr size);
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+
+/* Benchmark Functions */
+
+// Fastest of repeats runs of body in milliseconds, the fastest run is the one least disturbed by the rest of the system
+template <typename Body>
+double BestTime(int repeats, Body body)
+{
+	double best = std::numeric_limits<double>::max();
+	for (int i = 0; i < repeats; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	return best;
+}
+
+// Generic generators called with a function pointer and with a lambda, which the compiler can inline
+void RunGenerationBenchmark();
+
+// Systems of entity_system.h on the EntityStore and on an array of structs with the same components
+void RunEntityBenchmark();
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "benchmarks.h"
+
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLM/gtc/quaternion.hpp"
+
+#include "entity_system.h"
+
+/* Entity Benchmark Constants */
+
+static const int frames = 200;
+static const float delta_time = 1 / 60.f;
+
+static const int rover_counts[] = { 3, 1000, 10000, 100000 };
+
+/* Array of Structs Baseline */
+
+// Every component of an EntityStore entity in one struct, the layout the store replaced
+struct Entity
+{
+	glm::vec3 position;
+	glm::vec3 velocity;
+	glm::quat orientation;
+	float scale;
+	int parent;
+	int mesh_id;
+	glm::vec3 color;
+	float wobble_amplitude;
+	unsigned char driving;
+	int chase_target;
+	float chase_rate;
+	unsigned char collided;
+	glm::vec3 world_position;
+};
+
+// Same systems as entity_system.h, each walks the whole array of structs
+static void RunEntitySystems(std::vector<Entity>& entities, std::vector<InstanceBatch*>& batches)
+{
+	for (auto& entity : entities)
+	{
+		if (entity.collided)
+			entity.velocity = glm::vec3(0);
+		entity.position += entity.velocity * delta_time;
+	}
+
+	for (auto& entity : entities)
+		entity.world_position = entity.parent < 0 ? entity.position : entities[entity.parent].world_position + entity.position;
+
+	for (auto& entity : entities)
+	{
+		if (entity.chase_target < 0)
+			continue;
+		entity.driving = 1;
+		if (entity.collided)
+			continue;
+		auto world_position = glm::mix(entities[entity.chase_target].world_position, entity.world_position, 1 - entity.chase_rate);
+		entity.position += world_position - entity.world_position;
+	}
+
+	for (auto& entity : entities)
+		entity.world_position = entity.parent < 0 ? entity.position : entities[entity.parent].world_position + entity.position;
+
+	for (auto& entity : entities)
+	{
+		if (entity.chase_target < 0 || entity.collided || !CheckCollision(entity.world_position, entities[entity.chase_target].world_position))
+			continue;
+		entity.collided = 1;
+		entities[entity.chase_target].collided = 1;
+	}
+
+	for (auto batch : batches)
+		batch->instances.clear();
+	auto instance = CreateMeshInstance(glm::mat4(1), glm::vec3(0), false, glm::vec3(0.1f, 0, 0.1f), 0, 40);
+	for (auto& entity : entities)
+	{
+		if (entity.mesh_id < 0)
+			continue;
+
+		auto root = &entity;
+		while (root->parent >= 0)
+			root = &entities[root->parent];
+
+		instance.model = glm::mat4(glm::mat3_cast(entity.orientation) * entity.scale);
+		instance.model[3] = glm::vec4(entity.world_position, 1);
+		instance.color = entity.color;
+		instance.wobble_amplitude = root->driving ? entity.wobble_amplitude : 0.f;
+		batches[entity.mesh_id]->instances.push_back(instance);
+	}
+}
+
+/* Helper Functions */
+
+// Same rovers as --rovers, the first one is driven and the others chase it
+static std::vector<RoverDescription> DescribeRovers(int rover_count)
+{
+	std::vector<RoverDescription> rovers = { { glm::vec3(0, 0, -2.2), glm::vec3(1, 0, 0), -1, 0 } };
+	auto grid_side = int(glm::ceil(glm::sqrt(float(rover_count))));
+	for (int i = 1; i < rover_count; ++i)
+	{
+		auto cell = glm::vec2(i % grid_side, i / grid_side) / float(grid_side);
+		auto chase_rate = 0.005f + 0.015f * glm::fract(i * 0.618034f);
+		rovers.push_back({ glm::vec3(cell * 3.f - 1.5f, -2.2f), glm::vec3(cell, 1 - cell.x), 0, chase_rate });
+	}
+	return rovers;
+}
+
+// Copies the entities of the store into the array of structs
+static std::vector<Entity> ToArrayOfStructs(const EntityStore& store)
+{
+	std::vector<Entity> entities(store.positions.size());
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		auto& entity = entities[i];
+		entity.position = store.positions[i];
+		entity.velocity = store.velocities[i];
+		entity.orientation = store.orientations[i];
+		entity.scale = store.scales[i];
+		entity.parent = store.parents[i];
+		entity.mesh_id = store.mesh_ids[i];
+		entity.color = store.colors[i];
+		entity.wobble_amplitude = store.wobble_amplitudes[i];
+		entity.driving = store.driving[i];
+		entity.chase_target = store.chase_targets[i];
+		entity.chase_rate = store.chase_rates[i];
+		entity.collided = store.collided[i];
+		entity.world_position = store.world_positions[i];
+	}
+	return entities;
+}
+
+/* Entity Benchmark Functions */
+void RunEntityBenchmark()
+{
+	for (auto rover_count : rover_counts)
+	{
+		InstanceBatch bodies = {}, tires = {};
+		std::vector<InstanceBatch*> batches = { &bodies, &tires };
+
+		// Both start over for every run, so every run sees the same chase
+		EntityStore initial_store;
+		auto rovers = CreateRovers(initial_store, DescribeRovers(rover_count), 0, 1);
+		auto initial_entities = ToArrayOfStructs(initial_store);
+
+		EntityStore store;
+		auto structure_of_arrays = BestTime(5, [&]()
+		{
+			store = initial_store;
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				store.velocities[rovers[0]] = glm::vec3(0.8f, 0, 0);
+				store.driving[rovers[0]] = 1;
+				IntegrateVelocities(store, delta_time);
+				UpdateWorldPositions(store);
+				ChaseTargets(store);
+				UpdateWorldPositions(store);
+				DetectCollisions(store);
+				FillInstanceBatches(store, batches);
+			}
+		}) / frames;
+
+		std::vector<Entity> entities;
+		auto array_of_structs = BestTime(5, [&]()
+		{
+			entities = initial_entities;
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				entities[rovers[0]].velocity = glm::vec3(0.8f, 0, 0);
+				entities[rovers[0]].driving = 1;
+				RunEntitySystems(entities, batches);
+			}
+		}) / frames;
+
+		auto same = true;
+		for (size_t i = 0; i < entities.size(); ++i)
+			same = same && entities[i].world_position == store.world_positions[i];
+
+		std::cout << "Entity systems for " << store.positions.size() << " entities: structure of arrays " << structure_of_arrays
+			<< " ms, array of structs " << array_of_structs << " ms per frame" << (same ? "" : ", the positions differ") << std::endl;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "benchmarks.h"
+
+#include "mesh_generation.h"
+
+/* Generation Benchmark Constants */
+
+static const int repeats = 5;
+
+static const double torus_radius = 0.7;
+static const double tube_radius = 0.3;
+
+/* Helper Functions */
+
+static glm::dvec3 ParametricTorus(double v, double r)
+{
+	auto a = v * glm::two_pi<double>();
+	auto b = r * glm::two_pi<double>();
+	auto ring_radius = torus_radius + tube_radius * cos(a);
+	return glm::dvec3(ring_radius * cos(b), tube_radius * sin(a), ring_radius * sin(b));
+}
+
+/* Generation Benchmark Functions */
+void RunGenerationBenchmark()
+{
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> uvs;
+	std::vector<GLuint> indices;
+
+	// Surface evaluated per vertex, plus 4 more times for the finite differences
+	auto pointer_3d = BestTime(repeats, [&]()
+	{
+		GenerateParametricShapeFrom3D(positions, normals, indices, ParametricTorus, 512, 512);
+	});
+	auto pointer_positions = positions;
+
+	// Same surface, with the tube radius as state of the callable
+	auto radius = tube_radius;
+	auto lambda_3d = BestTime(repeats, [&]()
+	{
+		GenerateParametricShapeFrom3D(positions, normals, indices, [radius](double v, double r)
+		{
+			auto a = v * glm::two_pi<double>();
+			auto b = r * glm::two_pi<double>();
+			auto ring_radius = torus_radius + radius * cos(a);
+			return glm::dvec3(ring_radius * cos(b), radius * sin(a), ring_radius * sin(b));
+		}, 512, 512);
+	});
+
+	std::cout << "GenerateParametricShapeFrom3D 512x512 torus: function pointer " << pointer_3d
+		<< " ms, lambda " << lambda_3d << " ms" << (positions == pointer_positions ? "" : ", the meshes differ") << std::endl;
+
+	auto pointer_2d = BestTime(repeats, [&]()
+	{
+		GenerateParametricShapeFrom2D(positions, normals, uvs, indices, ParametricHalfCircle, 1024, 1024);
+	});
+	pointer_positions = positions;
+
+	auto lambda_2d = BestTime(repeats, [&]()
+	{
+		GenerateParametricShapeFrom2D(positions, normals, uvs, indices, [](double t) { return ParametricHalfCircle(t); }, 1024, 1024);
+	});
+
+	std::cout << "GenerateParametricShapeFrom2D 1024x1024 sphere: function pointer " << pointer_2d
+		<< " ms, lambda " << lambda_2d << " ms" << (positions == pointer_positions ? "" : ", the meshes differ") << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#include "benchmarks.h"
+
+// Build in Release, the benchmarks measure what the optimizer makes of the code
+int main()
+{
+	RunGenerationBenchmark();
+	RunEntityBenchmark();
+	return 0;
+}
\ No newline at end of file
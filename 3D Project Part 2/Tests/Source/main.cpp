@@ -0,0 +1,28 @@
+#include "tests.h"
+
+static int failed_checks = 0;
+
+bool Check(bool passed, const char* description)
+{
+	if (!passed)
+	{
+		std::cout << "Failed: " << description << std::endl;
+		++failed_checks;
+	}
+	return passed;
+}
+
+int FailedChecks()
+{
+	return failed_checks;
+}
+
+// Exits with the number of failed checks, so a build step can run it
+int main()
+{
+	RunQuantizationTests();
+	RunSimplificationTests();
+
+	std::cout << (failed_checks == 0 ? "All checks passed." : "Some checks failed.") << std::endl;
+	return failed_checks;
+}
\ No newline at end of file
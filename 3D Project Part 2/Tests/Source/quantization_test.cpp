@@ -0,0 +1,50 @@
+#include "tests.h"
+
+#include <vector>
+#include "GLM/glm.hpp"
+
+#include "opengl_utilities.h"
+#include "mesh_generation.h"
+
+/* Quantization Test Constants */
+
+// One quantization step of u, which covers quantized_uv_range.x
+static const float uv_step = quantized_uv_range.x / 65535.f;
+
+/* Quantization Tests */
+
+static bool RoundTripsUV(const glm::vec2& uv)
+{
+	auto vertex = QuantizeVertex(glm::vec3(0), glm::vec3(0, 1, 0), uv, glm::vec3(1), glm::vec3(0));
+	auto decoded = DequantizeUV(vertex);
+	return glm::abs(decoded.x - uv.x) <= uv_step && glm::abs(decoded.y - uv.y) <= uv_step;
+}
+
+void RunQuantizationTests()
+{
+	Check(RoundTripsUV(glm::vec2(1.1f, 0.3f)), "a seam copy at u = 1.1 keeps its u");
+	Check(RoundTripsUV(glm::vec2(0, 1)), "the corners of the uv range keep their uv");
+	Check(RoundTripsUV(glm::vec2(1.999f, 0)), "u just under 2 keeps its u");
+
+	// Seam and pole copies of the sphere generators reach past u = 1
+	for (int subdivisions : { 3, 6 })
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> uvs;
+		std::vector<GLuint> indices;
+		GenerateIcosphere(positions, normals, uvs, indices, subdivisions);
+
+		size_t past_seam = 0;
+		size_t lost = 0;
+		for (auto& uv : uvs)
+			if (uv.x > 1)
+			{
+				++past_seam;
+				lost += RoundTripsUV(uv) ? 0 : 1;
+			}
+
+		Check(past_seam > 0, "the icosphere has vertices past u = 1");
+		Check(lost == 0, "the icosphere vertices past u = 1 keep their uv");
+	}
+}
\ No newline at end of file
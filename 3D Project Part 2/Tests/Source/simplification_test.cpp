@@ -0,0 +1,53 @@
+#include "tests.h"
+
+#include <vector>
+#include "GLM/glm.hpp"
+
+#include "mesh_generation.h"
+#include "mesh_simplification.h"
+
+/* Simplification Tests */
+
+// Triangles wound counterclockwise around the surface normals of their corners. Collapses only move
+// vertices onto their neighbours, so the normals still tell which side of the surface is outside.
+static size_t CounterclockwiseTriangles(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<GLuint>& indices)
+{
+	size_t counterclockwise = 0;
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		auto& a = positions[indices[t]];
+		auto face_normal = glm::cross(positions[indices[t + 1]] - a, positions[indices[t + 2]] - a);
+		auto surface_normal = normals[indices[t]] + normals[indices[t + 1]] + normals[indices[t + 2]];
+		if (glm::dot(face_normal, surface_normal) > 0)
+			++counterclockwise;
+	}
+	return counterclockwise;
+}
+
+// Triangles wound the other way than most triangles of the mesh before simplifying
+static size_t InvertedAfterSimplifying(
+	ParametricLineBatch parametric_line,
+	int segments,
+	RevolutionTopology topology,
+	size_t target_triangle_count
+)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	std::vector<GLuint> indices;
+	GenerateParametricShapeFrom2D(positions, normals, uvs, indices, parametric_line, segments, segments, topology);
+	auto counterclockwise = CounterclockwiseTriangles(positions, normals, indices) * 2 > indices.size() / 3;
+
+	SimplifyMesh(positions, normals, uvs, indices, target_triangle_count);
+	auto counterclockwise_after = CounterclockwiseTriangles(positions, normals, indices);
+	return counterclockwise ? indices.size() / 3 - counterclockwise_after : counterclockwise_after;
+}
+
+void RunSimplificationTests()
+{
+	Check(InvertedAfterSimplifying(ParametricHalfCircleBatch, 129, RevolutionTopology{ true, false }, 512) == 0,
+		"a textured sphere simplified to 512 triangles has no inverted triangles");
+	Check(InvertedAfterSimplifying(ParametricCircleBatch, 257, RevolutionTopology{ true, true }, 128) == 0,
+		"a welded torus simplified to 128 triangles has no inverted triangles");
+}
\ No newline at end of file
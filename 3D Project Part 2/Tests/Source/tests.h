@@ -0,0 +1,17 @@
+#pragma once
+
+#include <iostream>
+
+/* Test Functions */
+
+// Prints the description of a check that did not pass and counts it, returns passed
+bool Check(bool passed, const char* description);
+
+// Number of checks that did not pass so far
+int FailedChecks();
+
+// Copies of seam vertices at u + 1 keep their texture coordinates through QuantizeVertex
+void RunQuantizationTests();
+
+// Heavily simplified surfaces of revolution keep every triangle facing out
+void RunSimplificationTests();
\ No newline at end of file